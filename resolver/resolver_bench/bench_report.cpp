@@ -0,0 +1,110 @@
+#include "bench_report.hpp"
+#include "json_writer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+
+phase_summary summarize(const std::vector<double>& samples)
+{
+   phase_summary result;
+   if (samples.empty())
+   {
+      return result;
+   }
+
+   auto sorted = samples;
+   std::sort(sorted.begin(), sorted.end());
+   auto rank = [&sorted](double percent)
+   {
+      auto index = static_cast<std::size_t>(std::ceil(percent * sorted.size() / 100.));
+      return sorted[std::max<std::size_t>(index, 1) - 1];
+   };
+
+   result.min = sorted.front();
+   result.median = rank(50.);
+   result.p99 = rank(99.);
+   result.mean = std::accumulate(sorted.begin(), sorted.end(), 0.) / sorted.size();
+   return result;
+}
+
+bench_report::bench_report(std::string time_unit)
+   : _time_unit(std::move(time_unit))
+{}
+
+phase_samples& bench_report::add(const std::string& scenario, const std::string& phase, std::int32_t diameter, std::size_t units)
+{
+   phase_samples new_phase;
+   new_phase.scenario = scenario;
+   new_phase.phase = phase;
+   new_phase.diameter = diameter;
+   new_phase.units = units;
+   _phases.emplace_back(std::move(new_phase));
+   return _phases.back();
+}
+
+void bench_report::print(std::ostream& stream) const
+{
+   stream << std::left << std::setw(16) << "scenario" << std::setw(24) << "phase"
+      << std::right << std::setw(12) << "median_" + _time_unit << std::setw(12) << "p99_" + _time_unit << std::endl;
+   for (const auto& current : _phases)
+   {
+      auto summary = summarize(current.samples);
+      stream << std::left << std::setw(16) << current.scenario << std::setw(24) << current.phase
+         << std::right << std::fixed << std::setprecision(1)
+         << std::setw(12) << summary.median << std::setw(12) << summary.p99 << std::endl;
+   }
+}
+
+int bench_report::write_csv(const astd::filesystem::path& path) const
+{
+   std::ofstream stream(path.c_str(), std::ios::trunc);
+   if (!stream)
+   {
+      return OPEN_FILE;
+   }
+
+   const auto& u = _time_unit;
+   stream << "scenario,diameter,units,phase,repetitions,min_" << u << ",median_" << u << ",p99_" << u << ",mean_" << u << "\n";
+   stream << std::fixed << std::setprecision(3);
+   for (const auto& current : _phases)
+   {
+      auto summary = summarize(current.samples);
+      stream << current.scenario << ',' << current.diameter << ',' << current.units << ',' << current.phase << ','
+         << current.samples.size() << ',' << summary.min << ',' << summary.median << ','
+         << summary.p99 << ',' << summary.mean << '\n';
+   }
+   return stream ? NONE : OPEN_FILE;
+}
+
+int bench_report::write_json(const astd::filesystem::path& path) const
+{
+   std::ofstream stream(path.c_str(), std::ios::trunc);
+   if (!stream)
+   {
+      return OPEN_FILE;
+   }
+
+   auto column = [this](const char* name) { return std::string(name) + "_" + _time_unit; };
+   json_writer writer(stream);
+   writer.begin_array();
+   for (const auto& current : _phases)
+   {
+      auto summary = summarize(current.samples);
+      writer.begin_object();
+      writer.key("diameter").value(current.diameter);
+      writer.key(column("max")).value(current.samples.empty() ? 0. : *std::max_element(current.samples.begin(), current.samples.end()));
+      writer.key(column("mean")).value(summary.mean);
+      writer.key(column("median")).value(summary.median);
+      writer.key(column("min")).value(summary.min);
+      writer.key(column("p99")).value(summary.p99);
+      writer.key("phase").value(current.phase.c_str());
+      writer.key("repetitions").value(std::uint32_t(current.samples.size()));
+      writer.key("scenario").value(current.scenario.c_str());
+      writer.key("units").value(std::uint32_t(current.units));
+      writer.end_object();
+   }
+   writer.end_array();
+   return writer.flush() ? NONE : OPEN_FILE;
+}
@@ -0,0 +1,74 @@
+#ifndef BENCH_REPORT_HPP
+#define BENCH_REPORT_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <deque>
+#include <vector>
+#include "afilesystem.hpp"
+
+// timings of one phase over the repetitions of a scenario, in the time unit of the report
+struct phase_samples
+{
+   std::string scenario;
+   std::string phase;
+   std::size_t units = 0;
+   std::int32_t diameter = 0;
+   std::vector<double> samples;
+};
+
+struct phase_summary
+{
+   double min = 0.;
+   double median = 0.;
+   double p99 = 0.;
+   double mean = 0.;
+};
+
+//percentiles use the nearest rank, samples are copied before sorting
+phase_summary summarize(const std::vector<double>& samples);
+
+class bench_timer
+{
+public:
+   bench_timer() : _start(std::chrono::steady_clock::now()) {}
+
+   double elapsed_us() const
+   {
+      return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _start).count();
+   }
+
+   double elapsed_ns() const
+   {
+      return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - _start).count();
+   }
+
+private:
+   std::chrono::steady_clock::time_point _start;
+};
+
+class bench_report
+{
+public:
+   enum error_code : int
+   {
+      NONE = 0,
+      OPEN_FILE = 1
+   };
+
+   //time_unit suffixes the columns of the report, "us" or "ns"
+   explicit bench_report(std::string time_unit = "us");
+
+   phase_samples& add(const std::string& scenario, const std::string& phase, std::int32_t diameter, std::size_t units);
+
+   void print(std::ostream& stream) const;
+   int write_csv(const astd::filesystem::path& path) const;
+   int write_json(const astd::filesystem::path& path) const;
+
+private:
+   std::string _time_unit;
+   std::deque<phase_samples> _phases; //references returned by add stay valid
+};
+
+#endif //!BENCH_REPORT_HPP
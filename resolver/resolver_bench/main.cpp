@@ -0,0 +1,160 @@
+#include <iostream>
+#include <string>
+#include "afilesystem.hpp"
+#include "resolver_config.hpp"
+#include "data_parser.hpp"
+#include "game_resolver.hpp"
+#include "task_scheduler.hpp"
+#include "data_dumper.hpp"
+#include "scenario_generator.hpp"
+#include "bench_report.hpp"
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/parsers.hpp>
+
+struct bench_settings
+{
+	std::uint32_t warmup = 2;
+	std::uint32_t repetitions = 10;
+	astd::filesystem::path work_dir;
+};
+
+static void bench_scenario(const scenario_parameters& params, const bench_settings& settings, bench_report& report)
+{
+	std::string name = std::to_string(params.diameter) + "x" + std::to_string(params.units_per_player * params.players);
+	auto input_path = settings.work_dir / name / "input";
+	auto output_path = settings.work_dir / name / "output";
+	if (write_scenario(generate_scenario(params), input_path) != data_dumper::NONE)
+	{
+		std::cerr << "ERROR : writing scenario " << name << " failed" << std::endl;
+		return;
+	}
+
+	auto units = std::size_t(params.units_per_player) * params.players;
+	auto& parse = report.add(name, "parse", params.diameter, units);
+	auto& orders = report.add(name, "orders", params.diameter, units);
+	auto& close_combat = report.add(name, "close_combat", params.diameter, units);
+	auto& dead_removal = report.add(name, "dead_removal", params.diameter, units);
+	auto& dump = report.add(name, "dump", params.diameter, units);
+
+	for (std::uint32_t i = 0; i < settings.warmup + settings.repetitions; ++i)
+	{
+		bool record = i >= settings.warmup;
+
+		bench_timer parse_timer;
+		data_parser parser(input_path, params.turn);
+		double parse_time = parse_timer.elapsed_us();
+
+		//phases are run one by one, in the order of game_resolver::resolve
+		game_resolver resolver(parser.get(), false);
+		bench_timer orders_timer;
+		resolver.initialize_action_points();
+		resolver.execute_orders();
+		double orders_time = orders_timer.elapsed_us();
+
+		bench_timer dead_timer;
+		resolver.bring_out_the_dead();
+		double dead_time = dead_timer.elapsed_us();
+
+		bench_timer close_combat_timer;
+		resolver.close_combat_action();
+		double close_combat_time = close_combat_timer.elapsed_us();
+
+		dead_timer = bench_timer();
+		resolver.bring_out_the_dead();
+		dead_time += dead_timer.elapsed_us();
+		task_scheduler::global().for_each_thread([](std::size_t) { turn_arena::local().release(); });
+
+		bench_timer dump_timer;
+		data_dumper dumper(resolver.data(), output_path);
+		double dump_time = dump_timer.elapsed_us();
+
+		if (record)
+		{
+			parse.samples.push_back(parse_time);
+			orders.samples.push_back(orders_time);
+			close_combat.samples.push_back(close_combat_time);
+			dead_removal.samples.push_back(dead_time);
+			dump.samples.push_back(dump_time);
+		}
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	std::cout << "This is resolver benchmark version " << RESOLVER_VERSION_MAJOR << "." << RESOLVER_VERSION_MINOR << std::endl;
+
+	scenario_parameters base;
+	bench_settings settings;
+	std::string sizes;
+
+	boost::program_options::options_description desc("Allowed options");
+	desc.add_options()("help", "produce this help message")
+		("sizes", boost::program_options::value<std::string>(&sizes)->default_value("8:50,12:250,20:1000"), "<DIAMETER:UNITS,...> scenarios to run, units are per player")
+		("players", boost::program_options::value<std::uint32_t>(&base.players)->default_value(4), "<NUM> amount of players of every scenario")
+		("stack-density", boost::program_options::value<float>(&base.stack_density)->default_value(2.f), "<NUM> average units of a player per occupied tile")
+		("seed", boost::program_options::value<std::uint32_t>(&base.seed)->default_value(base.seed), "<NUM> random seed of the scenarios")
+		("warmup", boost::program_options::value<std::uint32_t>(&settings.warmup)->default_value(settings.warmup), "<NUM> untimed runs before the repetitions")
+		("repetitions", boost::program_options::value<std::uint32_t>(&settings.repetitions)->default_value(settings.repetitions), "<NUM> timed runs per scenario")
+		("work-dir", boost::program_options::value<astd::filesystem::path>(), "<PATH> directory of the generated scenarios (default : <temp>/resolver_bench)")
+		("csv", boost::program_options::value<astd::filesystem::path>(), "<PATH> write the report as csv")
+		("json", boost::program_options::value<astd::filesystem::path>(), "<PATH> write the report as json");
+
+	boost::program_options::variables_map vm;
+	try {
+		boost::program_options::store(boost::program_options::command_line_parser(argc, argv)
+			.options(desc)
+			.style(boost::program_options::command_line_style::unix_style |
+				boost::program_options::command_line_style::allow_long_disguise)
+			.run()
+			, vm);
+
+		boost::program_options::notify(vm);
+	}
+	catch (const boost::program_options::error& e)
+	{
+		std::cerr << "ERROR : " << e.what() << std::endl;
+		std::cout << desc << std::endl;
+		return 1;
+	}
+
+	if (vm.find("help") != vm.end())
+	{
+		std::cout << "resolver_bench [--help] [--sizes <d:u,...>] [--warmup <num>] [--repetitions <num>] [--csv <path>] [--json <path>]" << std::endl;
+		std::cout << desc << std::endl;
+		return 0;
+	}
+
+	std::vector<scenario_parameters> scenarios;
+	if (!parse_scenario_sizes(sizes, base, scenarios) || !base.players || !settings.repetitions)
+	{
+		std::cerr << "ERROR : sizes " << sizes << " not valid" << std::endl;
+		return 1;
+	}
+
+	auto it_work_dir = vm.find("work-dir");
+	settings.work_dir = it_work_dir != vm.end()
+		? it_work_dir->second.as<astd::filesystem::path>()
+		: astd::filesystem::temp_directory_path() / "resolver_bench";
+
+	bench_report report;
+	for (const auto& scenario : scenarios)
+	{
+		bench_scenario(scenario, settings, report);
+	}
+	report.print(std::cout);
+
+	int result = bench_report::NONE;
+	auto it_csv = vm.find("csv");
+	if (it_csv != vm.end())
+	{
+		result |= report.write_csv(it_csv->second.as<astd::filesystem::path>());
+	}
+	auto it_json = vm.find("json");
+	if (it_json != vm.end())
+	{
+		result |= report.write_json(it_json->second.as<astd::filesystem::path>());
+	}
+	return result;
+}
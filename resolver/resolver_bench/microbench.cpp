@@ -0,0 +1,181 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include "resolver_config.hpp"
+#include "game_resolver.hpp"
+#include "scenario_generator.hpp"
+#include "bench_report.hpp"
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/parsers.hpp>
+
+// per call cost of the small functions called for every tile and unit of a turn
+// each sample is a batch of calls over inputs prepared beforehand, divided by the batch size
+
+struct microbench_settings
+{
+	std::uint32_t batch = 10000;
+	std::uint32_t repetitions = 20;
+	std::string filter;
+};
+
+//results are accumulated here so the calls can't be optimized away
+static volatile std::uint64_t sink = 0;
+
+template<typename F>
+static void run_case(const std::string& scenario, const char* name, const scenario_parameters& params, const microbench_settings& settings, bench_report& report, F&& func)
+{
+	if (!settings.filter.empty() && std::string(name).find(settings.filter) == std::string::npos)
+	{
+		return;
+	}
+
+	auto& samples = report.add(scenario, name, params.diameter, std::size_t(params.units_per_player) * params.players);
+	std::uint64_t result = 0;
+	//first batch is a warmup
+	for (std::uint32_t i = 0; i <= settings.repetitions; ++i)
+	{
+		bench_timer timer;
+		for (std::uint32_t j = 0; j < settings.batch; ++j)
+		{
+			result += func(j);
+		}
+		double elapsed = timer.elapsed_ns();
+		if (i)
+		{
+			samples.samples.push_back(elapsed / settings.batch);
+		}
+	}
+	sink = sink + result;
+}
+
+static void bench_primitives(const scenario_parameters& params, const microbench_settings& settings, bench_report& report)
+{
+	std::string scenario = std::to_string(params.diameter) + "x" + std::to_string(params.units_per_player * params.players);
+	game_resolver resolver(generate_scenario(params), false);
+	const auto& data = resolver.data();
+
+	std::mt19937 rng(params.seed);
+	std::uniform_int_distribution<std::size_t> tile_distribution(0, data.current_map.grid.size() - 1);
+	std::uniform_int_distribution<std::size_t> unit_distribution(0, data.units.size() - 1);
+	std::vector<coordinate> coords(settings.batch);
+	std::vector<std::string> ref_strings(settings.batch);
+	std::vector<reference> refs(settings.batch);
+	std::vector<std::string> order_strings(settings.batch);
+	for (std::uint32_t i = 0; i < settings.batch; ++i)
+	{
+		coords[i] = data.current_map.grid[tile_distribution(rng)].first;
+		refs[i] = data.units.empty() ? reference(reference::UNI, i) : data.units[unit_distribution(rng)].id;
+		ref_strings[i] = refs[i].serialize().data();
+		auto order_name = order::serialize(static_cast<order::T_type>(i % order::SIZE));
+		order_strings[i].assign(order_name.data(), order_name.size());
+	}
+	const auto& origin = coords.front();
+	const auto& owner = data.players.front();
+
+	run_case(scenario, "neighbors", params, settings, report, [&](std::uint32_t i)
+	{
+		return resolver.neighbors(coords[i]).size();
+	});
+	run_case(scenario, "distance", params, settings, report, [&](std::uint32_t i)
+	{
+		return resolver.distance(origin, coords[i]);
+	});
+	run_case(scenario, "get_terrain", params, settings, report, [&](std::uint32_t i)
+	{
+		return resolver.get_terrain(coords[i]).cover;
+	});
+	run_case(scenario, "movement_cost", params, settings, report, [&](std::uint32_t i)
+	{
+		return static_cast<std::uint64_t>(resolver.get_movement_cost(coords[i]));
+	});
+	run_case(scenario, "movement_cost_player", params, settings, report, [&](std::uint32_t i)
+	{
+		return static_cast<std::uint64_t>(resolver.get_movement_cost(coords[i], owner) > 1.f);
+	});
+	run_case(scenario, "reference_parse", params, settings, report, [&](std::uint32_t i)
+	{
+		return reference(ref_strings[i]).packed();
+	});
+	run_case(scenario, "reference_serialize", params, settings, report, [&](std::uint32_t i)
+	{
+		return std::uint64_t(refs[i].serialize()[reference::PREFIX_SIZE]);
+	});
+	run_case(scenario, "order_parse", params, settings, report, [&](std::uint32_t i)
+	{
+		return std::uint64_t(order::parse(order_strings[i]));
+	});
+}
+
+int main(int argc, char ** argv)
+{
+	std::cout << "This is resolver microbenchmark version " << RESOLVER_VERSION_MAJOR << "." << RESOLVER_VERSION_MINOR << std::endl;
+
+	scenario_parameters base;
+	microbench_settings settings;
+	std::string sizes;
+
+	boost::program_options::options_description desc("Allowed options");
+	desc.add_options()("help", "produce this help message")
+		("sizes", boost::program_options::value<std::string>(&sizes)->default_value("5:10,10:100,20:500"), "<DIAMETER:UNITS,...> scenarios to run, units are per player")
+		("players", boost::program_options::value<std::uint32_t>(&base.players)->default_value(4), "<NUM> amount of players of every scenario")
+		("seed", boost::program_options::value<std::uint32_t>(&base.seed)->default_value(base.seed), "<NUM> random seed of the scenarios and inputs")
+		("batch", boost::program_options::value<std::uint32_t>(&settings.batch)->default_value(settings.batch), "<NUM> calls per sample")
+		("repetitions", boost::program_options::value<std::uint32_t>(&settings.repetitions)->default_value(settings.repetitions), "<NUM> samples per case")
+		("filter", boost::program_options::value<std::string>(&settings.filter), "<NAME> only run the cases containing NAME")
+		("csv", boost::program_options::value<astd::filesystem::path>(), "<PATH> write the report as csv")
+		("json", boost::program_options::value<astd::filesystem::path>(), "<PATH> write the report as json");
+
+	boost::program_options::variables_map vm;
+	try {
+		boost::program_options::store(boost::program_options::command_line_parser(argc, argv)
+			.options(desc)
+			.style(boost::program_options::command_line_style::unix_style |
+				boost::program_options::command_line_style::allow_long_disguise)
+			.run()
+			, vm);
+
+		boost::program_options::notify(vm);
+	}
+	catch (const boost::program_options::error& e)
+	{
+		std::cerr << "ERROR : " << e.what() << std::endl;
+		std::cout << desc << std::endl;
+		return 1;
+	}
+
+	if (vm.find("help") != vm.end())
+	{
+		std::cout << "resolver_microbench [--help] [--sizes <d:u,...>] [--batch <num>] [--repetitions <num>] [--filter <name>] [--csv <path>] [--json <path>]" << std::endl;
+		std::cout << desc << std::endl;
+		return 0;
+	}
+
+	std::vector<scenario_parameters> scenarios;
+	if (!parse_scenario_sizes(sizes, base, scenarios) || !base.players || !settings.batch || !settings.repetitions)
+	{
+		std::cerr << "ERROR : sizes " << sizes << " not valid" << std::endl;
+		return 1;
+	}
+
+	bench_report report("ns");
+	for (const auto& scenario : scenarios)
+	{
+		bench_primitives(scenario, settings, report);
+	}
+	report.print(std::cout);
+
+	int result = bench_report::NONE;
+	auto it_csv = vm.find("csv");
+	if (it_csv != vm.end())
+	{
+		result |= report.write_csv(it_csv->second.as<astd::filesystem::path>());
+	}
+	auto it_json = vm.find("json");
+	if (it_json != vm.end())
+	{
+		result |= report.write_json(it_json->second.as<astd::filesystem::path>());
+	}
+	return result;
+}
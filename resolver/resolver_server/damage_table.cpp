@@ -0,0 +1,66 @@
+#include "damage_table.hpp"
+#include <algorithm>
+
+void damage_table::build(const game_data& data)
+{
+   _attacks = data.attack_action.size();
+   _defs = data.unit_defs.size() + 1;
+   _terrains = data.terrains.size() + 1;
+
+   //aggregated defense and cover usage of every definition, last slot for the missing one
+   std::vector<unit_action> defenses(_defs);
+   std::vector<float> cover_usages(_defs, 0.f);
+   for (std::size_t d = 0; d + 1 < _defs; ++d)
+   {
+      const auto& def = data.unit_defs[d];
+      for (auto index : def.defense_index)
+      {
+         if (index == NO_INDEX)
+            continue;
+         defenses[d].hard += data.defense_action[index].hard;
+         defenses[d].soft += data.defense_action[index].soft;
+      }
+      cover_usages[d] = def.cover_usage;
+   }
+
+   std::vector<std::int32_t> covers(_terrains, 0);
+   for (std::size_t t = 0; t + 1 < _terrains; ++t)
+   {
+      covers[t] = data.terrains[t].cover;
+   }
+
+   _base.resize(_attacks * _defs * _terrains);
+   for (std::size_t a = 0; a < _attacks; ++a)
+   {
+      const auto& att = data.attack_action[a];
+      for (std::size_t d = 0; d < _defs; ++d)
+      {
+         for (std::size_t t = 0; t < _terrains; ++t)
+         {
+            _base[(a * _defs + d) * _terrains + t] = std::max((att.soft - (defenses[d].soft * covers[t] * cover_usages[d]))
+               + (att.hard - (defenses[d].hard * covers[t] * cover_usages[d])), 0.f);
+         }
+      }
+   }
+
+   _ranked.assign((_defs - 1) * _defs * _terrains, ranking());
+   for (std::size_t attacker = 0; attacker + 1 < _defs; ++attacker)
+   {
+      const auto& attacks = data.unit_defs[attacker].attack_index;
+      for (std::size_t d = 0; d < _defs; ++d)
+      {
+         for (std::size_t t = 0; t < _terrains; ++t)
+         {
+            auto& result = _ranked[(attacker * _defs + d) * _terrains + t];
+            for (auto index : attacks)
+            {
+               result.push_back(index);
+            }
+            std::stable_sort(result.begin(), result.end(), [this, d, t](std::uint32_t lval, std::uint32_t rval)
+            {
+               return base(lval, std::uint32_t(d), std::uint32_t(t)) > base(rval, std::uint32_t(d), std::uint32_t(t));
+            });
+         }
+      }
+   }
+}
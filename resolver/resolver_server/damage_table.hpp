@@ -0,0 +1,48 @@
+#ifndef DAMAGE_TABLE_HPP
+#define DAMAGE_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "data.hpp"
+
+// damage of every attack against every unit definition on every terrain, before the
+// endurance scaling of the attacker, built once from linked game_data (see link_references)
+// a NO_INDEX definition or terrain has its own slot, behaving like a default constructed one
+// also ranks the attacks of every unit definition by decreasing damage per defender and terrain
+class damage_table
+{
+public:
+   typedef xts::static_vector<std::uint32_t, 8> ranking;
+
+   void build(const game_data& data);
+
+   //max(soft - defense soft * cover * cover usage + hard - defense hard * cover * cover usage, 0)
+   float base(std::uint32_t attack, std::uint32_t defender_def, std::uint32_t terrain) const
+   {
+      if (attack >= _attacks)
+         return 0.f;
+      return _base[(std::size_t(attack) * _defs + def_slot(defender_def)) * _terrains + terrain_slot(terrain)];
+   }
+
+   //attack indices of attacker_def, most damaging first, equal damages in declaration order
+   const ranking& ranked(std::uint32_t attacker_def, std::uint32_t defender_def, std::uint32_t terrain) const
+   {
+      if (attacker_def >= _defs - 1)
+         return _empty;
+      return _ranked[(std::size_t(attacker_def) * _defs + def_slot(defender_def)) * _terrains + terrain_slot(terrain)];
+   }
+
+private:
+   std::size_t _attacks = 0;
+   std::size_t _defs = 1; //unit definitions + the NO_INDEX slot
+   std::size_t _terrains = 1; //terrains + the NO_INDEX slot
+   std::vector<float> _base;
+   std::vector<ranking> _ranked;
+   ranking _empty;
+
+   std::size_t def_slot(std::uint32_t index) const { return index < _defs - 1 ? index : _defs - 1; }
+   std::size_t terrain_slot(std::uint32_t index) const { return index < _terrains - 1 ? index : _terrains - 1; }
+};
+
+#endif //!DAMAGE_TABLE_HPP
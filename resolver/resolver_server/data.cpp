@@ -1,4 +1,5 @@
 #include "data.hpp"
+#include "diagnostics.hpp"
 
 #include <iterator>
 
@@ -18,7 +19,7 @@ order::T_type order::parse(astd::string_view str)
 	{
 		return static_cast<order::T_type>(std::distance(converter_arr.begin(), it));
 	}
-	std::cerr << "WARNING : " << str << " is not a reconized order" << std::endl;
+	diagnostics::global().report(diagnostics::ORDER_UNKNOWN, str);
 	return order::NONE;
 }
 
@@ -2,47 +2,123 @@
 #define DATA_HPP
 
 #include <vector>
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <limits>
 #include <ostream>
 #include <map>
 #include <deque>
+#include <memory>
+#include <cassert>
+#include <cstdint>
+#include <functional>
 
 #include "reference.hpp"
+#include "range_mask.hpp"
+#include "string_pool.hpp"
 #include "astring_view.hpp"
 #include "static_vector.hpp"
 #include "static_hashmap.hpp"
 
+// axial hex coordinate packed on 32 bits, the cube z = -(x + y) is derived
 struct coordinate
 {
-   std::int32_t x = 0;
-   std::int32_t y = 0;
-   std::int32_t z = 0;
+   //bounds of a parsed x or y, one inside the int16 range so that the neighbors of every tile are stored too
+   enum : std::int32_t
+   {
+      MIN_VALUE = std::numeric_limits<std::int16_t>::min() + 1,
+      MAX_VALUE = std::numeric_limits<std::int16_t>::max() - 1
+   };
+
+   std::int16_t x = 0;
+   std::int16_t y = 0;
+
+   coordinate() = default;
+
+   //x_ and y_ must fit in int16, the parser rejects the values out of [MIN_VALUE, MAX_VALUE]
+   coordinate(std::int32_t x_, std::int32_t y_)
+      : x(static_cast<std::int16_t>(x_)), y(static_cast<std::int16_t>(y_))
+   {
+      assert(x == x_ && y == y_);
+   }
+
+   static bool in_range(std::int64_t x_, std::int64_t y_)
+   {
+      return x_ >= MIN_VALUE && x_ <= MAX_VALUE && y_ >= MIN_VALUE && y_ <= MAX_VALUE;
+   }
+
+   //cube form, z must be -(x + y) and isn't stored
+   coordinate(std::int32_t x_, std::int32_t y_, std::int32_t z_)
+      : coordinate(x_, y_)
+   {
+      assert(x_ + y_ + z_ == 0);
+   }
+
+   std::int32_t z() const
+   {
+      return -(std::int32_t(x) + std::int32_t(y));
+   }
+
+   std::uint32_t packed() const
+   {
+      return (std::uint32_t(std::uint16_t(x)) << 16) | std::uint16_t(y);
+   }
 };
 
+static_assert(sizeof(coordinate) == sizeof(std::uint32_t), "coordinate must stay packed");
+
 static std::ostream& operator<<(std::ostream& stream, const coordinate& coord)
 {
-	stream << coord.x << ' ' << coord.y << ' ' << coord.z;
+	stream << coord.x << ' ' << coord.y << ' ' << coord.z();
 	return stream;
 }
 
 static bool operator==(const coordinate& lval, const coordinate& rval)
 {
-	return lval.x == rval.x && lval.y == rval.y && lval.z == rval.z;
+	return lval.packed() == rval.packed();
 }
 
+//x then y
 static bool operator<(const coordinate& lval, const coordinate& rval)
 {
-	bool result = lval.x < rval.x;
-	if (lval.x == rval.x)
-		result = lval.y < rval.y;
-	if(lval.y == rval.y)
-		result = lval.z < rval.z;
-	return result;
+	return lval.x < rval.x || (lval.x == rval.x && lval.y < rval.y);
+}
+
+//position on a Morton (Z-order) curve : close tiles get close keys
+inline std::uint32_t morton_key(const coordinate& coord)
+{
+	auto spread = [](std::uint32_t num)
+	{
+		num = (num | (num << 8)) & 0x00FF00FFu;
+		num = (num | (num << 4)) & 0x0F0F0F0Fu;
+		num = (num | (num << 2)) & 0x33333333u;
+		num = (num | (num << 1)) & 0x55555555u;
+		return num;
+	};
+	//offset so that negative coordinates keep their order
+	return (spread(std::uint16_t(coord.x + 0x8000)) << 1) | spread(std::uint16_t(coord.y + 0x8000));
+}
+
+namespace std
+{
+	template<>
+	struct hash<coordinate>
+	{
+		std::size_t operator()(const coordinate& coord) const
+		{
+			return static_cast<std::size_t>((std::uint64_t(coord.packed()) * 0x9E3779B97F4A7C15ull) >> 32);
+		}
+	};
 }
 
 
+// position of a linked reference in its game_data container, see link_references
+enum : std::uint32_t
+{
+   NO_INDEX = 0xFFFFFFFFu
+};
+
 // order.json
 struct order
 {
@@ -57,6 +133,7 @@ struct order
    T_type type;
    reference modifier;
    coordinate target;
+   std::uint32_t modifier_index = NO_INDEX; //in game_data::attack_action
 
    static const std::array< astd::string_view, SIZE> converter_arr;
    static T_type parse(astd::string_view str);
@@ -66,21 +143,52 @@ struct order
 //map.json
 struct map
 {
-   std::string name;
-   std::string description;
+   astd::string_view name;
+   astd::string_view description;
    std::int32_t diameter = 0;
-   xts::static_vector<std::pair<coordinate, reference>, 512> grid;
+   std::vector<std::pair<coordinate, reference>> grid;
+
+   //filled by link_references : terrain index of every tile of the bounding box of the grid,
+   //indexed by x then y from tile_origin, NO_INDEX where there is no tile
+   //left empty when the bounding box is more than DENSE_AREA_RATIO times the tile count
+   std::vector<std::uint32_t> tile_terrain;
+   coordinate tile_origin;
+   std::int32_t tile_width = 0;
+   std::int32_t tile_height = 0;
+   //filled instead of tile_terrain on sparse maps : coordinate::packed() and terrain index of every tile, sorted
+   std::vector<std::pair<std::uint32_t, std::uint32_t>> tile_sorted;
+
+   enum : std::size_t
+   {
+      DENSE_AREA_RATIO = 4
+   };
+
+   std::uint32_t terrain_index(const coordinate& coord) const
+   {
+      if (!tile_sorted.empty())
+      {
+         auto key = coord.packed();
+         auto it = std::lower_bound(tile_sorted.begin(), tile_sorted.end(), key,
+            [](const std::pair<std::uint32_t, std::uint32_t>& tile, std::uint32_t value) { return tile.first < value; });
+         return it != tile_sorted.end() && it->first == key ? it->second : NO_INDEX;
+      }
+      auto dx = std::int32_t(coord.x) - tile_origin.x;
+      auto dy = std::int32_t(coord.y) - tile_origin.y;
+      if (dx < 0 || dy < 0 || dx >= tile_width || dy >= tile_height)
+         return NO_INDEX;
+      return tile_terrain[std::size_t(dx) * tile_height + dy];
+   }
 };
 
 //def_attack.json & def_defense.json
 struct unit_action
 {
    reference id;
-   std::string name;
-   std::string description;
+   astd::string_view name;
+   astd::string_view description;
    std::int32_t soft = 0;
    std::int32_t hard = 0;
-   std::array<std::uint32_t, 2> range = { 0 };
+   range_mask range = 0;
    std::int32_t cost = 0;
 };
 
@@ -90,6 +198,8 @@ struct unit
    reference id;
    reference owner;
    reference type;
+   std::uint32_t owner_index = NO_INDEX; //in game_data::players
+   std::uint32_t type_index = NO_INDEX; //in game_data::unit_defs
    coordinate pos;
    std::deque<order> actions;
    std::int32_t endurance = 0;
@@ -106,22 +216,25 @@ struct unit
 struct unit_definition
 {
    reference id;
-   std::string name;
-   std::string description;
+   astd::string_view name;
+   astd::string_view description;
    xts::static_vector<reference, 8> attack;
    xts::static_vector<reference, 8> defense;
+   xts::static_vector<std::uint32_t, 8> attack_index; //in game_data::attack_action, same order as attack
+   xts::static_vector<std::uint32_t, 8> defense_index; //in game_data::defense_action, same order as defense
+   range_mask attack_range = 0; //union of the ranges of attack, filled by link_references
    xts::static_vector<order::T_type, order::SIZE> order_accessible;
    std::int32_t action_point = 0;
    float cover_usage = 0.f;
-   std::string texture;
+   astd::string_view texture;
 };
 
 //player.json
 struct player
 {
    reference id;
-   std::string name;
-   std::string description;
+   astd::string_view name;
+   astd::string_view description;
    xts::static_vector<coordinate, 8> rally_point;
    char team = 0;
 };
@@ -130,13 +243,40 @@ struct player
 struct terrain
 {
    reference id;
-   std::string name;
-   std::string description;
+   astd::string_view name;
+   astd::string_view description;
    float infrastructure = 0.f; //let's avoid overflow
    std::int32_t cover = 0;
-   std::string texture_path;
+   astd::string_view texture_path;
+};
+
+
+//content hashes of the sections game_resolver never modifies, computed at parse time
+//lets data_dumper keep the previous file instead of serializing the section again
+//code modifying one of these sections must reset its hash to UNKNOWN
+struct section_digest
+{
+   enum T_section
+   {
+      DEF_ATTACK,
+      DEF_DEFENSE,
+      DEF_MAP,
+      DEF_UNIT,
+      MAP,
+      PLAYER,
+      SIZE
+   };
+
+   enum : std::uint64_t
+   {
+      UNKNOWN = 0
+   };
+
+   std::array<std::uint64_t, SIZE> hash = { { UNKNOWN } };
 };
 
+// the text fields of the definitions are views into game_data::strings
+// they are only read back by data_dumper, copies of game_data share the same pool
 
 struct game_data
 {
@@ -148,6 +288,9 @@ struct game_data
    std::vector<unit_definition> unit_defs;
    std::vector<player> players;
    std::vector<terrain> terrains;
+   std::int32_t turn = -1; //turn of the orders loaded, -1 if unknown
+   section_digest digest;
+   std::shared_ptr<string_pool> strings = std::make_shared<string_pool>();
 };
 
 #endif //DATA_HPP
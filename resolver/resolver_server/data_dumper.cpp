@@ -1,23 +1,247 @@
-
 #include "data_dumper.hpp"
+#include "json_writer.hpp"
+#include "trace_recorder.hpp"
+#include "task_scheduler.hpp"
+#include "json/json.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+   //jsoncpp wrote the members of an object in key order, the dumped files keep that order
+   //whatever the order of the vectors
+   template<typename T>
+   std::vector<const T*> sorted_on_id(const std::vector<T>& values)
+   {
+      std::vector<const T*> result;
+      result.reserve(values.size());
+      for (const auto& value : values)
+      {
+         result.push_back(&value);
+      }
+      std::sort(result.begin(), result.end(), [](const T* lval, const T* rval) { return lval->id < rval->id; });
+      return result;
+   }
+}
+
+const char* const data_dumper::manifest_filename = "turn_manifest.json";
 
-data_dumper::data_dumper(const game_data& data, const astd::filesystem::path& target)
+data_dumper::data_dumper(const game_data& data, const astd::filesystem::path& target, bool sync, const std::vector<extra_file>& extra_files)
 {
    if (!astd::filesystem::exists(target))
    {
       astd::filesystem::create_directories(target);
    }
 
-   _status = dump_def_attack(target / "def_attack.json", data.attack_action);
-   _status |= dump_def_defense(target / "def_defense.json", data.defense_action);
-   _status |= dump_def_map(target / "def_map.json", data.terrains);
-   _status |= dump_def_unit(target / "def_unit.json", data.unit_defs);
-   _status |= dump_map(target / "map.json", data.current_map);
-   _status |= dump_order(target / "order.json", data.units, data.unit_dead, false);
-   _status |= dump_order(target / "order_rejected.json", data.units, data.unit_dead, true);
-   _status |= dump_player(target / "player.json", data.players);
-   _status |= dump_unit(target / "unit.json", data.units);
-   _status |= dump_unit(target / "unit_dead.json", data.unit_dead);
+   auto previous_hashes = load_manifest_hashes(target);
+   std::error_code err;
+   astd::filesystem::remove(target / manifest_filename, err);
+
+   using std::placeholders::_1;
+   std::vector<dump_job> jobs =
+   {
+      { "def_attack.json", section_digest::DEF_ATTACK, std::bind(&data_dumper::dump_def_attack, this, _1, std::cref(data.attack_action)) },
+      { "def_defense.json", section_digest::DEF_DEFENSE, std::bind(&data_dumper::dump_def_defense, this, _1, std::cref(data.defense_action)) },
+      { "def_map.json", section_digest::DEF_MAP, std::bind(&data_dumper::dump_def_map, this, _1, std::cref(data.terrains)) },
+      { "def_unit.json", section_digest::DEF_UNIT, std::bind(&data_dumper::dump_def_unit, this, _1, std::cref(data.unit_defs)) },
+      { "map.json", section_digest::MAP, std::bind(&data_dumper::dump_map, this, _1, std::cref(data.current_map)) },
+      { "order.json", section_digest::SIZE, std::bind(&data_dumper::dump_order, this, _1, std::cref(data.units), std::cref(data.unit_dead), false) },
+      { "order_rejected.json", section_digest::SIZE, std::bind(&data_dumper::dump_order, this, _1, std::cref(data.units), std::cref(data.unit_dead), true) },
+      { "player.json", section_digest::PLAYER, std::bind(&data_dumper::dump_player, this, _1, std::cref(data.players)) },
+      { "unit.json", section_digest::SIZE, std::bind(&data_dumper::dump_unit, this, _1, std::cref(data.units)) },
+      { "unit_dead.json", section_digest::SIZE, std::bind(&data_dumper::dump_unit, this, _1, std::cref(data.unit_dead)) },
+   };
+
+   for (const auto& extra : extra_files)
+   {
+      dump_job job;
+      job.filename = extra.filename;
+      job.dump = [&extra](const astd::filesystem::path& path) { return extra.dump(path) == 0 ? int(NONE) : int(OPEN_FILE); };
+      jobs.push_back(std::move(job));
+   }
+
+   for (auto& job : jobs)
+   {
+      if (job.section == section_digest::SIZE || data.digest.hash[job.section] == section_digest::UNKNOWN)
+      {
+         continue;
+      }
+      job.hash = data.digest.hash[job.section];
+
+      //only a file written by a previous dump is kept, the input files don't have the dumped layout
+      auto previous = previous_hashes.find(job.filename);
+      job.unchanged = previous != previous_hashes.end() && previous->second == job.hash
+         && astd::filesystem::exists(target / job.filename, err);
+   }
+
+   run_jobs(jobs, target);
+
+   _status = NONE;
+   for (const auto& job : jobs)
+   {
+      _status |= job.status;
+   }
+
+   if (sync)
+   {
+      _status |= sync_directory(target);
+   }
+
+   if (_status == NONE)
+   {
+      _status |= dump_manifest(target, data, jobs);
+   }
+}
+
+void data_dumper::run_jobs(std::vector<dump_job>& jobs, const astd::filesystem::path& target)
+{
+   //one task per file, the big files (unit, order) dominate anyway
+   task_scheduler::global().parallel_for(0, jobs.size(), 1, [&jobs, &target](std::size_t i)
+   {
+      run_job(jobs[i], target);
+   });
+}
+
+void data_dumper::run_job(dump_job& job, const astd::filesystem::path& target)
+{
+   if (job.unchanged)
+   {
+      job.written = true;
+      return;
+   }
+
+   trace_scope scope("dump_file");
+   scope.set_detail(job.filename);
+
+   auto final_path = target / job.filename;
+   auto temp_path = target / (std::string(job.filename) + ".tmp");
+   std::error_code err;
+
+   astd::filesystem::remove(temp_path, err);
+   job.status = job.dump(temp_path);
+   if (!astd::filesystem::exists(temp_path, err))
+   {
+      return;
+   }
+
+   if (job.status != NONE)
+   {
+      astd::filesystem::remove(temp_path, err);
+      return;
+   }
+
+   astd::filesystem::rename(temp_path, final_path, err);
+   if (err)
+   {
+      std::cerr << "ERROR : cannot rename " << temp_path << " to " << final_path << " : " << err.message() << std::endl;
+      astd::filesystem::remove(temp_path, err);
+      job.status = RENAME_FILE;
+      return;
+   }
+   job.written = true;
+}
+
+std::map<std::string, std::uint64_t> data_dumper::load_manifest_hashes(const astd::filesystem::path& target)
+{
+   std::map<std::string, std::uint64_t> result;
+   std::ifstream stream((target / manifest_filename).c_str());
+   if (!stream)
+   {
+      return result;
+   }
+
+   Json::Value root;
+   Json::CharReaderBuilder rbuilder;
+   std::string errs;
+   if (!Json::parseFromStream(rbuilder, stream, &root, &errs))
+   {
+      return result;
+   }
+
+   //a file of an older layout must not be kept
+   const auto& version = root["format_version"];
+   if (!version.isInt() || version.asInt() != FORMAT_VERSION)
+   {
+      return result;
+   }
+
+   const auto& hashes = root["hashes"];
+   auto names = hashes.getMemberNames();
+   for (const auto& name : names)
+   {
+      result[name] = std::strtoull(hashes[name].asCString(), nullptr, 16);
+   }
+   return result;
+}
+
+int data_dumper::sync_directory(const astd::filesystem::path& target)
+{
+#ifndef _WIN32
+   int fd = ::open(target.c_str(), O_RDONLY);
+   if (fd < 0)
+   {
+      return SYNC_FAILED;
+   }
+   int result = ::fsync(fd) == 0 ? NONE : SYNC_FAILED;
+   ::close(fd);
+   return result;
+#else
+   //renames are journaled by NTFS, nothing to flush at directory level
+   return NONE;
+#endif
+}
+
+int data_dumper::dump_manifest(const astd::filesystem::path& target, const game_data& data, const std::vector<dump_job>& jobs)
+{
+   dump_job manifest_job;
+   manifest_job.filename = manifest_filename;
+   manifest_job.dump = [&data, &jobs](const astd::filesystem::path& path)
+   {
+      std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
+      if (!stream)
+      {
+         return int(OPEN_FILE);
+      }
+
+      json_writer writer(stream);
+      writer.begin_object();
+      writer.key("files").begin_array();
+      for (const auto& job : jobs)
+      {
+         if (job.written)
+         {
+            writer.value(job.filename);
+         }
+      }
+      writer.end_array();
+
+      writer.key("format_version").value(std::int32_t(FORMAT_VERSION));
+
+      writer.key("hashes").begin_object();
+      for (const auto& job : jobs)
+      {
+         if (job.written && job.hash != section_digest::UNKNOWN)
+         {
+            char hex[17];
+            std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(job.hash));
+            writer.key(job.filename).value(hex);
+         }
+      }
+      writer.end_object();
+
+      writer.key("turn").value(data.turn);
+      writer.end_object();
+      return writer.flush() ? int(NONE) : int(OPEN_FILE);
+   };
+
+   run_job(manifest_job, target);
+   return manifest_job.status;
 }
 
 data_dumper::error_code data_dumper::status() const
@@ -32,29 +256,37 @@ int data_dumper::dump_def_attack(const astd::filesystem::path& path, const std::
       return NONE;
    }
 
-   std::ofstream stream(path.c_str(), std::ios::trunc);
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
 
    if (stream)
    {
-      Json::Value root;
+      json_writer writer(stream);
+      writer.begin_object();
 
-      for (const auto& action : acc)
+      for (const auto* action_ptr : sorted_on_id(acc))
       {
-         Json::Value action_value;
-         action_value["name"] = action.name;
-         action_value["description"] = action.description;
-         action_value["soft"] = action.soft;
-         action_value["hard"] = action.hard;
-         for (const auto& range : action.range)
+         const auto& action = *action_ptr;
+         writer.key(action.id).begin_object();
+         writer.key("cost").value(action.cost);
+         writer.key("description").value(action.description);
+         writer.key("hard").value(action.hard);
+         writer.key("name").value(action.name);
+         //a single interval keeps the [min, max] form, anything else is written as "X-Y:Z"
+         auto range_min = range_lowest(action.range), range_max = range_highest(action.range);
+         if (action.range == range_between(range_min, range_max))
          {
-            action_value["range"].append(range);
+            writer.key("range").begin_array().value(range_min).value(range_max).end_array();
          }
-         action_value["cost"] = action.cost;
-         root[action.id.serialize().data()] = action_value;
+         else
+         {
+            writer.key("range").value(serialize_range(action.range));
+         }
+         writer.key("soft").value(action.soft);
+         writer.end_object();
       }
 
-      stream << root;
-      return NONE;
+      writer.end_object();
+      return writer.flush() ? NONE : OPEN_FILE;
    }
    return OPEN_FILE;
 }
@@ -65,25 +297,26 @@ int data_dumper::dump_def_defense(const astd::filesystem::path& path, const std:
    {
       return NONE;
    }
-   std::ofstream stream(path.c_str(), std::ios::trunc);
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
 
    if (stream)
    {
-      Json::Value root;
+      json_writer writer(stream);
+      writer.begin_object();
 
-      for (const auto& action : acc)
+      for (const auto* action_ptr : sorted_on_id(acc))
       {
-         Json::Value action_value;
-         action_value["name"] = action.name;
-         action_value["description"] = action.description;
-         action_value["soft"] = action.soft;
-         action_value["hard"] = action.hard;
-
-         root[action.id.serialize().data()] = action_value;
+         const auto& action = *action_ptr;
+         writer.key(action.id).begin_object();
+         writer.key("description").value(action.description);
+         writer.key("hard").value(action.hard);
+         writer.key("name").value(action.name);
+         writer.key("soft").value(action.soft);
+         writer.end_object();
       }
 
-      stream << root;
-      return NONE;
+      writer.end_object();
+      return writer.flush() ? NONE : OPEN_FILE;
    }
    return OPEN_FILE;
 }
@@ -95,26 +328,27 @@ int data_dumper::dump_def_map(const astd::filesystem::path& path, const std::vec
       return NONE;
    }
 
-   std::ofstream stream(path.c_str(), std::ios::trunc);
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
 
    if (stream)
    {
-      Json::Value root;
+      json_writer writer(stream);
+      writer.begin_object();
 
-      for (const auto& terrain : terrains)
+      for (const auto* terrain_ptr : sorted_on_id(terrains))
       {
-         Json::Value action_value;
-         action_value["name"] = terrain.name;
-         action_value["description"] = terrain.description;
-         action_value["infrastructure"] = terrain.infrastructure;
-         action_value["cover"] = terrain.cover;
-         action_value["texture"] = terrain.texture_path;
-
-         root[terrain.id.serialize().data()] = action_value;
+         const auto& terrain = *terrain_ptr;
+         writer.key(terrain.id).begin_object();
+         writer.key("cover").value(terrain.cover);
+         writer.key("description").value(terrain.description);
+         writer.key("infrastructure").value(terrain.infrastructure);
+         writer.key("name").value(terrain.name);
+         writer.key("texture").value(terrain.texture_path);
+         writer.end_object();
       }
 
-      stream << root;
-      return NONE;
+      writer.end_object();
+      return writer.flush() ? NONE : OPEN_FILE;
    }
    return OPEN_FILE;
 }
@@ -126,70 +360,79 @@ int data_dumper::dump_def_unit(const astd::filesystem::path& path, const std::ve
       return NONE;
    }
 
-   std::ofstream stream(path.c_str(), std::ios::trunc);
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
 
    if (stream)
    {
-      Json::Value root;
+      json_writer writer(stream);
+      writer.begin_object();
 
-      for (const auto& unit_def : unit_defs)
+      for (const auto* unit_def_ptr : sorted_on_id(unit_defs))
       {
-         Json::Value action_value;
-         action_value["name"] = unit_def.name;
-         action_value["description"] = unit_def.description;
-         for (const auto& attack : unit_def.attack)
+         const auto& unit_def = *unit_def_ptr;
+         writer.key(unit_def.id).begin_object();
+         writer.key("action_points").value(unit_def.action_point);
+
+         writer.key("actions").begin_array();
+         for (const auto& action : unit_def.order_accessible)
          {
-            action_value["attack"].append(attack.serialize().data());
+            writer.value(order::serialize(action));
          }
+         writer.end_array();
 
-         for (const auto& defense : unit_def.defense)
+         writer.key("attack").begin_array();
+         for (const auto& attack : unit_def.attack)
          {
-            action_value["defense"].append(defense.serialize().data());
+            writer.value(attack);
          }
+         writer.end_array();
 
-         for (const auto& action : unit_def.order_accessible)
+         writer.key("cover_usage").value(unit_def.cover_usage);
+
+         writer.key("defense").begin_array();
+         for (const auto& defense : unit_def.defense)
          {
-            action_value["actions"].append(order::serialize(action).data());
+            writer.value(defense);
          }
+         writer.end_array();
 
-         action_value["action_points"] = unit_def.action_point;
-         action_value["cover_usage"] = unit_def.cover_usage;
-         action_value["texture"] = unit_def.texture;
-
-         root[unit_def.id.serialize().data()] = action_value;
+         writer.key("description").value(unit_def.description);
+         writer.key("name").value(unit_def.name);
+         writer.key("texture").value(unit_def.texture);
+         writer.end_object();
       }
 
-      stream << root;
-      return NONE;
+      writer.end_object();
+      return writer.flush() ? NONE : OPEN_FILE;
    }
    return OPEN_FILE;
 }
 
 int data_dumper::dump_map(const astd::filesystem::path& path, const map& current_map)
 {
-   std::ofstream stream(path.c_str(), std::ios::trunc);
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
 
    if (stream)
    {
-      Json::Value root;
+      json_writer writer(stream);
+      writer.begin_object();
 
-      root["name"] = current_map.name;
-      root["description"] = current_map.description;
-      root["diameter"] = current_map.diameter;
+      writer.key("description").value(current_map.description);
+      writer.key("diameter").value(current_map.diameter);
+      writer.key("name").value(current_map.name);
 
+      writer.key("tiles").begin_array();
       for (auto& tile : current_map.grid)
       {
-         Json::Value json_tile;
-         Json::Value json_tile_position = coord_to_json_value(tile.first);
-         Json::Value json_tile_reference = tile.second.serialize().data();
-
-         json_tile.append(json_tile_position);
-         json_tile.append(json_tile_reference);
-         root["tiles"].append(json_tile);
+         writer.begin_array();
+         write_coord(writer, tile.first);
+         writer.value(tile.second);
+         writer.end_array();
       }
+      writer.end_array();
 
-      stream << root;
-      return NONE;
+      writer.end_object();
+      return writer.flush() ? NONE : OPEN_FILE;
    }
    return OPEN_FILE;
 }
@@ -217,27 +460,20 @@ int data_dumper::dump_order(const astd::filesystem::path& path, const std::vecto
 	   return NONE;
    }
 
-   std::ofstream stream(path.c_str(), std::ios::trunc);
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
 
    if (stream)
    {
-      Json::Value root;
+      json_writer writer(stream);
+      writer.begin_object();
 
+      //the rejected orders of the dead units are listed with the others, in key order
+      std::vector<const unit*> dumped;
       for (auto& un : units)
       {
 		  if (un.action_invalid == rejected)
 		  {
-			  Json::Value json_unit_orders;
-			  for (auto& acc : un.actions)
-			  {
-				  Json::Value json_acc;
-				  json_acc["action"] = order::serialize(acc.type).data();
-				  json_acc["x"] = acc.target.x;
-				  json_acc["y"] = acc.target.y;
-				  json_unit_orders.append(json_acc);
-			  }
-
-			  root[un.id.serialize().data()].append(json_unit_orders);
+			  dumped.push_back(&un);
 		  }
       }
 
@@ -245,22 +481,20 @@ int data_dumper::dump_order(const astd::filesystem::path& path, const std::vecto
 	  {
 		  for (auto& un : dead_units)
 		  {
-			  Json::Value json_unit_orders;
-			  for (auto& acc : un.actions)
-			  {
-				  Json::Value json_acc;
-				  json_acc["action"] = order::serialize(acc.type).data();
-				  json_acc["x"] = acc.target.x;
-				  json_acc["y"] = acc.target.y;
-				  json_unit_orders.append(json_acc);
-			  }
-
-			  root[un.id.serialize().data()].append(json_unit_orders);
+			  dumped.push_back(&un);
 		  }
 	  }
+      std::sort(dumped.begin(), dumped.end(), [](const unit* lval, const unit* rval) { return lval->id < rval->id; });
 
-      stream << root;
-      return NONE;
+      for (const auto* un : dumped)
+      {
+         writer.key(un->id).begin_array();
+         write_orders(writer, un->actions);
+         writer.end_array();
+      }
+
+      writer.end_object();
+      return writer.flush() ? NONE : OPEN_FILE;
    }
    return OPEN_FILE;
 }
@@ -272,28 +506,33 @@ int data_dumper::dump_player(const astd::filesystem::path& path, const std::vect
       return NONE;
    }
 
-   std::ofstream stream(path.c_str(), std::ios::trunc);
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
 
    if (stream)
    {
-      Json::Value root;
+      json_writer writer(stream);
+      writer.begin_object();
 
-      for (auto& player : players)
+      for (const auto* player_ptr : sorted_on_id(players))
       {
-         Json::Value json_player;
-         json_player["name"] = player.name;
-         json_player["description"] = player.description;
-         json_player["team"] = std::string() + player.team;
+         const auto& player = *player_ptr;
+         writer.key(player.id).begin_object();
+         writer.key("description").value(player.description);
+         writer.key("name").value(player.name);
+
+         writer.key("rally_points").begin_array();
          for (auto& rally : player.rally_point)
          {
-            json_player["rally_points"].append(coord_to_json_value(rally));
+            write_coord(writer, rally);
          }
+         writer.end_array();
 
-         root[player.id.serialize().data()] = json_player;
+         writer.key("team").value(astd::string_view(&player.team, 1));
+         writer.end_object();
       }
 
-      stream << root;
-      return NONE;
+      writer.end_object();
+      return writer.flush() ? NONE : OPEN_FILE;
    }
    return OPEN_FILE;
 }
@@ -305,33 +544,49 @@ int data_dumper::dump_unit(const astd::filesystem::path& path, const std::vector
       return NONE;
    }
 
-   std::ofstream stream(path.c_str(), std::ios::trunc);
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
 
    if (stream)
    {
-      Json::Value root;
+      json_writer writer(stream);
+      writer.begin_object();
 
-      for (auto& unit : units)
+      for (const auto* unit_ptr : sorted_on_id(units))
       {
-         Json::Value json_unit;
-         json_unit["owner"] = unit.owner.serialize().data();
-         json_unit["type"] = unit.type.serialize().data();
-         json_unit["position"] = coord_to_json_value(unit.pos);
-         json_unit["endurance"] = unit.endurance;
-
-         root[unit.id.serialize().data()] = json_unit;
+         const auto& unit = *unit_ptr;
+         writer.key(unit.id).begin_object();
+         writer.key("endurance").value(unit.endurance);
+         writer.key("owner").value(unit.owner);
+         writer.key("position");
+         write_coord(writer, unit.pos);
+         writer.key("type").value(unit.type);
+         writer.end_object();
       }
 
-      stream << root;
-      return NONE;
+      writer.end_object();
+      return writer.flush() ? NONE : OPEN_FILE;
    }
    return OPEN_FILE;
 }
 
-Json::Value data_dumper::coord_to_json_value(const coordinate& coord)
+void data_dumper::write_coord(json_writer& writer, const coordinate& coord)
 {
-   Json::Value result;
-   result.append(coord.x);
-   result.append(coord.y);
-   return result;
-}
\ No newline at end of file
+   writer.begin_array();
+   writer.value(coord.x);
+   writer.value(coord.y);
+   writer.end_array();
+}
+
+void data_dumper::write_orders(json_writer& writer, const std::deque<order>& orders)
+{
+   writer.begin_array();
+   for (auto& acc : orders)
+   {
+      writer.begin_object();
+      writer.key("action").value(order::serialize(acc.type));
+      writer.key("x").value(acc.target.x);
+      writer.key("y").value(acc.target.y);
+      writer.end_object();
+   }
+   writer.end_array();
+}
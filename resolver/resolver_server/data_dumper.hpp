@@ -3,22 +3,75 @@
 
 #include "afilesystem.hpp"
 #include "data.hpp"
-#include "json/json.h"
 #include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+class json_writer;
 
 class data_dumper
 {
 public:
    enum error_code : int {
-      NONE,
-      OPEN_FILE
+      NONE = 0,
+      OPEN_FILE = 1,
+      RENAME_FILE = 2,
+      SYNC_FAILED = 4
    };
 
-   data_dumper(const game_data& data, const astd::filesystem::path& target);
+   static const char* const manifest_filename;
+
+   //layout of the dumped files, recorded in the manifest : to increase with every change of a dump_ function,
+   //a previous dump of another version has its files written again
+   enum : std::int32_t
+   {
+      FORMAT_VERSION = 2
+   };
+
+   //file of the turn that isn't part of game_data (stats, diagnostics, journal)
+   //dump writes it at the path given and returns 0 on success
+   struct extra_file
+   {
+      const char* filename = nullptr;
+      std::function<int(const astd::filesystem::path&)> dump = nullptr;
+   };
+
+   //every file is written to a temporary file then renamed over the previous one
+   //the manifest is removed first and written last : when present, the directory holds a complete turn
+   //definitions, map and players whose section hash matches the manifest of the previous dump are not written again
+   //extra_files are written the same way and listed in the manifest, a failed one sets OPEN_FILE
+   //sync_directory : flush the directory entries to disk before the manifest is written
+   //data is only read while the jobs run, pass game_resolver::data() directly rather than a copy
+   data_dumper(const game_data& data, const astd::filesystem::path& target, bool sync_directory = false,
+      const std::vector<extra_file>& extra_files = std::vector<extra_file>());
 
    error_code status() const;
 
 private:
+   struct dump_job
+   {
+      const char* filename = nullptr;
+      section_digest::T_section section = section_digest::SIZE; //SIZE for the sections modified by the resolver
+      std::function<int(const astd::filesystem::path&)> dump = nullptr;
+      std::uint64_t hash = section_digest::UNKNOWN;
+      bool unchanged = false;
+      int status = NONE;
+      bool written = false;
+   };
+
+   //hashes recorded by the manifest of the previous dump in target, none when it was of another FORMAT_VERSION
+   static std::map<std::string, std::uint64_t> load_manifest_hashes(const astd::filesystem::path& target);
+
+   void run_jobs(std::vector<dump_job>& jobs, const astd::filesystem::path& target);
+
+   static void run_job(dump_job& job, const astd::filesystem::path& target);
+
+   static int sync_directory(const astd::filesystem::path& target);
+
+   int dump_manifest(const astd::filesystem::path& target, const game_data& data, const std::vector<dump_job>& jobs);
+
    int dump_def_attack(const astd::filesystem::path& path, const std::vector<unit_action>& acc);
 
    int dump_def_defense(const astd::filesystem::path& path, const std::vector<unit_action>& acc);
@@ -35,7 +88,9 @@ private:
 
    int dump_unit(const astd::filesystem::path& path, const std::vector<unit>& units);
 
-   Json::Value coord_to_json_value(const coordinate& coord);
+   static void write_coord(json_writer& writer, const coordinate& coord);
+
+   static void write_orders(json_writer& writer, const std::deque<order>& orders);
 
    int _status;
 };
@@ -0,0 +1,142 @@
+#include "data_hash.hpp"
+#include <cstring>
+
+namespace
+{
+   class fnv1a
+   {
+   public:
+      void add(const void* data, std::size_t size)
+      {
+         auto bytes = static_cast<const unsigned char*>(data);
+         for (std::size_t i = 0; i < size; ++i)
+         {
+            _value = (_value ^ bytes[i]) * 0x100000001b3ull;
+         }
+      }
+
+      void add(astd::string_view str)
+      {
+         add(std::uint64_t(str.size()));
+         add(str.data(), str.size());
+      }
+
+      void add(const reference& ref)
+      {
+         add(ref.packed());
+      }
+
+      void add(const coordinate& coord)
+      {
+         add(coord.x);
+         add(coord.y);
+      }
+
+      template<typename T>
+      void add(const T& pod)
+      {
+         add(&pod, sizeof(pod));
+      }
+
+      std::uint64_t value() const
+      {
+         return _value == section_digest::UNKNOWN ? 1 : _value;
+      }
+
+   private:
+      std::uint64_t _value = 0xcbf29ce484222325ull;
+   };
+}
+
+std::uint64_t hash_section(const std::vector<unit_action>& actions)
+{
+   fnv1a result;
+   for (const auto& action : actions)
+   {
+      result.add(action.id);
+      result.add(action.name);
+      result.add(action.description);
+      result.add(action.soft);
+      result.add(action.hard);
+      result.add(action.range);
+      result.add(action.cost);
+   }
+   return result.value();
+}
+
+std::uint64_t hash_section(const std::vector<terrain>& terrains)
+{
+   fnv1a result;
+   for (const auto& current : terrains)
+   {
+      result.add(current.id);
+      result.add(current.name);
+      result.add(current.description);
+      result.add(current.infrastructure);
+      result.add(current.cover);
+      result.add(current.texture_path);
+   }
+   return result.value();
+}
+
+std::uint64_t hash_section(const std::vector<unit_definition>& unit_defs)
+{
+   fnv1a result;
+   for (const auto& def : unit_defs)
+   {
+      result.add(def.id);
+      result.add(def.name);
+      result.add(def.description);
+      result.add(std::uint64_t(def.attack.size()));
+      for (const auto& ref : def.attack)
+      {
+         result.add(ref);
+      }
+      result.add(std::uint64_t(def.defense.size()));
+      for (const auto& ref : def.defense)
+      {
+         result.add(ref);
+      }
+      result.add(std::uint64_t(def.order_accessible.size()));
+      for (auto type : def.order_accessible)
+      {
+         result.add(std::int32_t(type));
+      }
+      result.add(def.action_point);
+      result.add(def.cover_usage);
+      result.add(def.texture);
+   }
+   return result.value();
+}
+
+std::uint64_t hash_section(const map& current_map)
+{
+   fnv1a result;
+   result.add(current_map.name);
+   result.add(current_map.description);
+   result.add(current_map.diameter);
+   for (const auto& tile : current_map.grid)
+   {
+      result.add(tile.first);
+      result.add(tile.second);
+   }
+   return result.value();
+}
+
+std::uint64_t hash_section(const std::vector<player>& players)
+{
+   fnv1a result;
+   for (const auto& current : players)
+   {
+      result.add(current.id);
+      result.add(current.name);
+      result.add(current.description);
+      result.add(std::uint64_t(current.rally_point.size()));
+      for (const auto& rally : current.rally_point)
+      {
+         result.add(rally);
+      }
+      result.add(current.team);
+   }
+   return result.value();
+}
@@ -0,0 +1,16 @@
+#ifndef DATA_HASH_HPP
+#define DATA_HASH_HPP
+
+#include <cstdint>
+#include <vector>
+#include "data.hpp"
+
+// 64 bits FNV-1a over the fields written by data_dumper
+// never return section_digest::UNKNOWN
+std::uint64_t hash_section(const std::vector<unit_action>& actions);
+std::uint64_t hash_section(const std::vector<terrain>& terrains);
+std::uint64_t hash_section(const std::vector<unit_definition>& unit_defs);
+std::uint64_t hash_section(const map& current_map);
+std::uint64_t hash_section(const std::vector<player>& players);
+
+#endif //!DATA_HASH_HPP
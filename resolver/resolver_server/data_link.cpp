@@ -0,0 +1,150 @@
+#include "data_link.hpp"
+#include "diagnostics.hpp"
+#include "reference_index.hpp"
+#include <algorithm>
+
+namespace
+{
+   template<typename T>
+   void index_container(const std::vector<T>& container, reference_index& index)
+   {
+      index.clear();
+      index.reserve(container.size());
+      for (std::size_t i = 0; i < container.size(); ++i)
+      {
+         index.insert(container[i].id, i);
+      }
+   }
+
+   class linker
+   {
+   public:
+      explicit linker(game_data& data)
+      {
+         index_container(data.attack_action, _attacks);
+         index_container(data.defense_action, _defenses);
+         index_container(data.terrains, _terrains);
+         index_container(data.unit_defs, _unit_defs);
+         index_container(data.players, _players);
+      }
+
+      std::uint32_t attack(const reference& ref) { return find(_attacks, ref, diagnostics::ATTACK_MISSING); }
+      std::uint32_t defense(const reference& ref) { return find(_defenses, ref, diagnostics::DEFENSE_MISSING); }
+      std::uint32_t terrain(const reference& ref) { return find(_terrains, ref, diagnostics::TERRAIN_MISSING); }
+      std::uint32_t unit_def(const reference& ref) { return find(_unit_defs, ref, diagnostics::UNIT_DEF_MISSING); }
+      std::uint32_t player(const reference& ref) { return find(_players, ref, diagnostics::PLAYER_MISSING); }
+
+      std::size_t missing() const { return _missing; }
+
+   private:
+      reference_index _attacks;
+      reference_index _defenses;
+      reference_index _terrains;
+      reference_index _unit_defs;
+      reference_index _players;
+      std::size_t _missing = 0;
+
+      std::uint32_t find(const reference_index& index, const reference& ref, diagnostics::T_kind kind)
+      {
+         auto pos = index.find(ref);
+         if (pos == reference_index::npos)
+         {
+            diagnostics::global().report(kind, ref);
+            ++_missing;
+            return NO_INDEX;
+         }
+         return static_cast<std::uint32_t>(pos);
+      }
+   };
+
+   void link_map(map& current_map, linker& link)
+   {
+      current_map.tile_terrain.clear();
+      current_map.tile_sorted.clear();
+      current_map.tile_width = 0;
+      current_map.tile_height = 0;
+      if (current_map.grid.empty())
+         return;
+
+      std::int32_t min_x = current_map.grid.front().first.x, max_x = min_x;
+      std::int32_t min_y = current_map.grid.front().first.y, max_y = min_y;
+      for (const auto& tile : current_map.grid)
+      {
+         min_x = std::min<std::int32_t>(min_x, tile.first.x);
+         max_x = std::max<std::int32_t>(max_x, tile.first.x);
+         min_y = std::min<std::int32_t>(min_y, tile.first.y);
+         max_y = std::max<std::int32_t>(max_y, tile.first.y);
+      }
+
+      current_map.tile_origin = coordinate(min_x, min_y);
+      current_map.tile_width = max_x - min_x + 1;
+      current_map.tile_height = max_y - min_y + 1;
+
+      //a few tiles far apart : a sorted table instead of a bounding box of empty slots
+      if (std::size_t(current_map.tile_width) * current_map.tile_height > map::DENSE_AREA_RATIO * current_map.grid.size())
+      {
+         auto& sorted = current_map.tile_sorted;
+         sorted.reserve(current_map.grid.size());
+         for (std::uint32_t i = 0; i < current_map.grid.size(); ++i)
+         {
+            sorted.emplace_back(current_map.grid[i].first.packed(), i);
+         }
+         //the first tile wins on duplicates, as a linear search of the grid would
+         std::stable_sort(sorted.begin(), sorted.end(), [](const auto& lval, const auto& rval) { return lval.first < rval.first; });
+         sorted.erase(std::unique(sorted.begin(), sorted.end(), [](const auto& lval, const auto& rval) { return lval.first == rval.first; }), sorted.end());
+         for (auto& tile : sorted)
+         {
+            tile.second = link.terrain(current_map.grid[tile.second].second);
+         }
+         return;
+      }
+
+      current_map.tile_terrain.assign(std::size_t(current_map.tile_width) * current_map.tile_height, NO_INDEX);
+
+      for (const auto& tile : current_map.grid)
+      {
+         auto slot = std::size_t(tile.first.x - min_x) * current_map.tile_height + (tile.first.y - min_y);
+         //the first tile wins on duplicates, as a linear search of the grid would
+         if (current_map.tile_terrain[slot] == NO_INDEX)
+         {
+            current_map.tile_terrain[slot] = link.terrain(tile.second);
+         }
+      }
+   }
+}
+
+std::size_t link_references(game_data& data)
+{
+   linker link(data);
+
+   link_map(data.current_map, link);
+
+   for (auto& def : data.unit_defs)
+   {
+      def.attack_index.clear();
+      def.attack_range = 0;
+      for (const auto& ref : def.attack)
+      {
+         def.attack_index.push_back(link.attack(ref));
+         if (def.attack_index.back() != NO_INDEX)
+            def.attack_range |= data.attack_action[def.attack_index.back()].range;
+      }
+      def.defense_index.clear();
+      for (const auto& ref : def.defense)
+      {
+         def.defense_index.push_back(link.defense(ref));
+      }
+   }
+
+   for (auto& current : data.units)
+   {
+      current.type_index = link.unit_def(current.type);
+      current.owner_index = link.player(current.owner);
+      for (auto& ord : current.actions)
+      {
+         ord.modifier_index = ord.type == order::FIRE ? link.attack(ord.modifier) : NO_INDEX;
+      }
+   }
+
+   return link.missing();
+}
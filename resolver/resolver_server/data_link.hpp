@@ -0,0 +1,14 @@
+#ifndef DATA_LINK_HPP
+#define DATA_LINK_HPP
+
+#include <cstddef>
+#include "data.hpp"
+
+// store next to every cross reference of game_data the index of the object it designates :
+// unit type and owner, attacks and defenses of the unit definitions, order modifiers,
+// terrain of the map tiles. dangling references get NO_INDEX and are reported to diagnostics
+// containers must not be reordered afterward, except game_data::units which carries its indices
+// return the amount of dangling references
+std::size_t link_references(game_data& data);
+
+#endif //!DATA_LINK_HPP
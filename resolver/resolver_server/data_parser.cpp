@@ -1,8 +1,15 @@
 #include "data_parser.hpp"
-
-data_parser::data_parser(const astd::filesystem::path& directory)
+#include "data_hash.hpp"
+#include "trace_recorder.hpp"
+#include "data_dumper.hpp"
+#include "diagnostics.hpp"
+#include "resolver_stats.hpp"
+#include "turn_journal.hpp"
+
+data_parser::data_parser(const astd::filesystem::path& directory, std::int32_t turn)
+	: _directory(directory)
 {
-	parse_configuration_directory(directory);
+	_status |= parse_configuration_directory(directory, turn);
 }
 
 const game_data& data_parser::data() const
@@ -15,6 +22,25 @@ game_data&& data_parser::get()
 	return std::move(_data);
 }
 
+int data_parser::status() const
+{
+	return _status;
+}
+
+std::int32_t data_parser::turn() const
+{
+	return _turn;
+}
+
+int data_parser::commit_turn() const
+{
+	if (_turn == order_file_index::NO_TURN)
+	{
+		return NONE;
+	}
+	return _order_files.save_manifest(_directory, _turn);
+}
+
 int data_parser::parse_def_attack(const astd::filesystem::path& path)
 {
 	Json::Value root;
@@ -34,21 +60,31 @@ int data_parser::parse_def_attack(const astd::filesystem::path& path)
 		{
 			unit_action acc;
 			acc.id = reference{ obj_names[i] };
-			acc.name = current_obj["name"].asString();
-			acc.description = current_obj["description"].asString();
+			acc.name = intern_string(current_obj["name"]);
+			acc.description = intern_string(current_obj["description"]);
 			acc.soft = current_obj["soft"].asInt();
 			acc.hard = current_obj["hard"].asInt();
+			//"X-Y:Z" string, or [X] and [X, Y] arrays
 			auto& range_container = current_obj["range"];
-			if (!range_container.size() || range_container.size() > 2)
+			bool range_ok = false;
+			if (range_container.isString())
 			{
-            std::cerr << path << std::endl;
-				std::cerr << "unrecognized range for " << acc.id << std::endl;
+				range_ok = parse_range(range_container.asString(), acc.range);
 			}
-			std::size_t range_index = 0;
-			for (auto& num : range_container)
+			else if (range_container.isArray() && range_container.size() == 1)
 			{
-				acc.range[range_index % acc.range.size()] = num.asUInt();
-            range_index++;
+				acc.range = range_between(range_container[0].asUInt(), range_container[0].asUInt());
+				range_ok = acc.range != 0;
+			}
+			else if (range_container.isArray() && range_container.size() == 2)
+			{
+				acc.range = range_between(range_container[0].asUInt(), range_container[1].asUInt());
+				range_ok = acc.range != 0;
+			}
+			if (!range_ok)
+			{
+				std::cerr << path << std::endl;
+				std::cerr << "unrecognized range for " << acc.id << std::endl;
 			}
 
 			acc.cost = current_obj["cost"].asInt();
@@ -56,6 +92,7 @@ int data_parser::parse_def_attack(const astd::filesystem::path& path)
 			_data.attack_action.emplace_back(acc);
 			++i;
 		}
+		set_digest(section_digest::DEF_ATTACK, hash_section(_data.attack_action));
 	}
 	else
 	{
@@ -85,14 +122,15 @@ int data_parser::parse_def_defense(const astd::filesystem::path& path)
 		{
 			unit_action acc;
 			acc.id = reference{ obj_names[i] };
-			acc.name = current_obj["name"].asString();
-			acc.description = current_obj["description"].asString();
+			acc.name = intern_string(current_obj["name"]);
+			acc.description = intern_string(current_obj["description"]);
 			acc.soft = current_obj["soft"].asInt();
 			acc.hard = current_obj["hard"].asInt();
 
 			_data.defense_action.emplace_back(acc);
 			++i;
 		}
+		set_digest(section_digest::DEF_DEFENSE, hash_section(_data.defense_action));
 	}
 	else
 	{
@@ -123,15 +161,16 @@ int data_parser::parse_def_map(const astd::filesystem::path& path)
 		{
 			terrain acc;
 			acc.id = reference{ obj_names[i] };
-			acc.name = current_obj["name"].asString();
-			acc.description = current_obj["description"].asString();
+			acc.name = intern_string(current_obj["name"]);
+			acc.description = intern_string(current_obj["description"]);
 			acc.infrastructure = current_obj["infrastructure"].asFloat();
 			acc.cover = current_obj["cover"].asInt();
-			acc.texture_path = current_obj["texture"].asString();
+			acc.texture_path = intern_string(current_obj["texture"]);
 
 			_data.terrains.emplace_back(acc);
 			++i;
 		}
+		set_digest(section_digest::DEF_MAP, hash_section(_data.terrains));
 	}
 	else
 	{
@@ -162,8 +201,8 @@ int data_parser::parse_def_unit(const astd::filesystem::path& path)
 		{
 			unit_definition acc;
 			acc.id = reference{ obj_names[i] };
-			acc.name = current_obj["name"].asString();
-			acc.description = current_obj["description"].asString();
+			acc.name = intern_string(current_obj["name"]);
+			acc.description = intern_string(current_obj["description"]);
 			for (auto& att : current_obj["attack"])
 			{
 				acc.attack.emplace_back(reference{ att.asCString() });
@@ -175,16 +214,17 @@ int data_parser::parse_def_unit(const astd::filesystem::path& path)
 
 			for (auto& ord : current_obj["actions"])
 			{
-				acc.order_accessible.emplace_back(order::parse(ord.asString()));
+				acc.order_accessible.emplace_back(order::parse(ord.asCString()));
 			}
 
 			acc.action_point = current_obj["action_points"].asInt();
 			acc.cover_usage = current_obj["cover_usage"].asFloat();
-			acc.texture = current_obj["texture"].asString();
+			acc.texture = intern_string(current_obj["texture"]);
 
 			_data.unit_defs.emplace_back(acc);
 			++i;
 		}
+		set_digest(section_digest::DEF_UNIT, hash_section(_data.unit_defs));
 	}
 	else
 	{
@@ -209,9 +249,15 @@ int data_parser::parse_map(const astd::filesystem::path& path)
 	if (parsing_ok)
 	{
 		map acc;
-		acc.name = root["name"].asString();
-		acc.description = root["description"].asString();
+		acc.name = intern_string(root["name"]);
+		acc.description = intern_string(root["description"]);
 		acc.diameter = root["diameter"].asUInt();
+		if (acc.diameter > coordinate::MAX_VALUE)
+		{
+			std::cerr << "ERROR : map diameter " << acc.diameter << " larger than " << coordinate::MAX_VALUE << std::endl;
+			_status |= COORDINATE_OUT_OF_RANGE;
+		}
+		acc.grid.reserve(root["tiles"].size());
 
 		for (auto& hexa : root["tiles"])
 		{
@@ -226,6 +272,7 @@ int data_parser::parse_map(const astd::filesystem::path& path)
 		}
 
 		_data.current_map = acc;
+		set_digest(section_digest::MAP, hash_section(_data.current_map));
 	}
 	else
 	{
@@ -250,30 +297,23 @@ int data_parser::parse_order(const astd::filesystem::path& path)
 	if (parsing_ok)
 	{
 		auto obj_names = root.getMemberNames();
+		reserve_units(obj_names.size());
 		std::size_t i = 0;
 		for (auto& current_obj : root)
 		{
-			auto unit_ref = reference(obj_names[i]);
-			auto unit_it = std::find_if(_data.units.begin(), _data.units.end(),
-				[&unit_ref](const unit& u) {return u.id == unit_ref; });
-			if (unit_it == _data.units.end())
-			{
-				unit u;
-				u.id = unit_ref;
-				unit_it = _data.units.insert(_data.units.end(), std::move(u));
-			}
+			auto& current_unit = find_or_insert_unit(reference(obj_names[i]));
 
 			for (auto& acc : current_obj)
 			{
 				order ord;
 				ord.type = order::parse(acc["action"].asCString());
-				ord.target = parse_coord_from_value(acc["x"].asInt(), acc["y"].asInt());
+				ord.target = parse_coord_from_value(acc["x"].asInt64(), acc["y"].asInt64());
 				
 				if (acc["modifier"] != Json::Value())
 				{
 					ord.modifier = reference(acc["modifier"].asCString());
 				}
-				unit_it->actions.emplace_back(ord);
+				current_unit.actions.emplace_back(ord);
 			}
 	
 			++i;
@@ -307,8 +347,8 @@ int data_parser::parse_player(const astd::filesystem::path& path)
 		{
 			player new_player;
 			new_player.id = reference{ obj_names[i] };
-			new_player.name = current_obj["name"].asString();
-			new_player.description = current_obj["description"].asString();
+			new_player.name = intern_string(current_obj["name"]);
+			new_player.description = intern_string(current_obj["description"]);
 			if (current_obj["team"] != Json::Value())
 			{
 				new_player.team = current_obj["team"].asCString()[0];
@@ -325,6 +365,7 @@ int data_parser::parse_player(const astd::filesystem::path& path)
 			_data.players.emplace_back(new_player);
 			++i;
 		}
+		set_digest(section_digest::PLAYER, hash_section(_data.players));
 	}
 	else
 	{
@@ -349,24 +390,16 @@ int data_parser::parse_unit(const astd::filesystem::path& path)
 	if (parsing_ok)
 	{
 		auto obj_names = root.getMemberNames();
+		reserve_units(obj_names.size());
 		std::size_t i = 0;
 		for (auto& current_obj : root)
 		{
-			auto unit_ref = reference(obj_names[i]);
-			auto unit_it = std::find_if(_data.units.begin(), _data.units.end(),
-				[&unit_ref](const unit& u) {return u.id == unit_ref; });
-			if (unit_it == _data.units.end())
-			{
-				unit u;
-				u.id = unit_ref;
-				unit_it = _data.units.insert(_data.units.end(), std::move(u));
-			}
+			auto& current_unit = find_or_insert_unit(reference(obj_names[i]));
 
-			unit_it->id = reference{ obj_names[i] };
-			unit_it->owner = reference(current_obj["owner"].asCString());
-			unit_it->type = reference(current_obj["type"].asCString());
-			unit_it->pos = parse_coord_from_value(current_obj["position"]);
-			unit_it->endurance = current_obj["endurance"].asInt();
+			current_unit.owner = reference(current_obj["owner"].asCString());
+			current_unit.type = reference(current_obj["type"].asCString());
+			current_unit.pos = parse_coord_from_value(current_obj["position"]);
+			current_unit.endurance = current_obj["endurance"].asInt();
 
 			++i;
 		}
@@ -380,21 +413,62 @@ int data_parser::parse_unit(const astd::filesystem::path& path)
 	return NONE;
 }
 
-int data_parser::parse_configuration_directory(const astd::filesystem::path& directory)
+astd::string_view data_parser::intern_string(const Json::Value& value)
 {
-	constexpr std::size_t FILE_TYPE_SIZE = 8;
+	const char* begin = nullptr;
+	const char* end = nullptr;
+	if (value.isString() && value.getString(&begin, &end))
+	{
+		return _data.strings->intern(astd::string_view(begin, end - begin));
+	}
+	return astd::string_view();
+}
+
+void data_parser::set_digest(section_digest::T_section section, std::uint64_t hash)
+{
+	_data.digest.hash[section] = hash;
+}
+
+void data_parser::reserve_units(std::size_t expected_count)
+{
+	_data.units.reserve(_data.units.size() + expected_count);
+	_unit_index.reserve(_data.units.size() + expected_count);
+}
+
+unit& data_parser::find_or_insert_unit(const reference& ref)
+{
+	auto inserted = _unit_index.insert(ref, _data.units.size());
+	if (inserted.second)
+	{
+		unit u;
+		u.id = ref;
+		_data.units.emplace_back(std::move(u));
+	}
+	return _data.units[inserted.first];
+}
+
+int data_parser::parse_configuration_directory(const astd::filesystem::path& directory, std::int32_t turn)
+{
+	constexpr std::size_t FILE_TYPE_SIZE = 7;
 	typedef std::pair<std::string, int(data_parser::*)(const astd::filesystem::path&)> state_machine_pair;
 	std::array<state_machine_pair, FILE_TYPE_SIZE> parsing_state_machine =
 	{
-		state_machine_pair{ "def_attack", &data_parser::parse_def_attack }
-		,{ "def_defense", &data_parser::parse_def_defense }
-		,{ "def_map", &data_parser::parse_def_map }
-		,{ "def_unit", &data_parser::parse_def_unit }
-		,{ "map", &data_parser::parse_map }
-		,{ "order", &data_parser::parse_order }
-		,{ "player", &data_parser::parse_player }
-		,{ "unit", &data_parser::parse_unit }
+		state_machine_pair{ "def_attack.json", &data_parser::parse_def_attack }
+		,{ "def_defense.json", &data_parser::parse_def_defense }
+		,{ "def_map.json", &data_parser::parse_def_map }
+		,{ "def_unit.json", &data_parser::parse_def_unit }
+		,{ "map.json", &data_parser::parse_map }
+		,{ "player.json", &data_parser::parse_player }
+		,{ "unit.json", &data_parser::parse_unit }
+	};
+
+	//files written by the resolver itself, never read back as input : the output directory may be the input one
+	const std::array<std::string, 9> ignored_files =
+	{
+		"order.json", "order_rejected.json", "unit_dead.json", order_file_index::manifest_filename, data_dumper::manifest_filename,
+		diagnostics::filename, resolver_stats::filename, turn_journal::filename, turn_journal::json_filename
 	};
+	const std::string temp_extension = ".tmp"; //left by an interrupted dump or manifest write
 
 	astd::filesystem::directory_iterator it(directory);
 	astd::filesystem::directory_iterator ite;
@@ -405,12 +479,17 @@ int data_parser::parse_configuration_directory(const astd::filesystem::path& dir
 	{
 		if (it->status().type() == astd::filesystem::file_type::regular)
 		{
-			auto parsing_function_it = std::find_if(parsing_state_machine.begin(), parsing_state_machine.end(), [&it](const state_machine_pair& pair) {return !it->path().filename().generic_string().compare(0, pair.first.size(), pair.first); });
+			auto filename = it->path().filename().generic_string();
+			auto parsing_function_it = std::find_if(parsing_state_machine.begin(), parsing_state_machine.end(), [&filename](const state_machine_pair& pair) {return filename == pair.first; });
 			if (parsing_function_it != parsing_state_machine.end())
 			{
+				trace_scope scope("parse_file");
+				scope.set_detail(filename);
 				result = result | (this->*parsing_function_it->second) (it->path());
 			}
-			else
+			else if (!_order_files.add(it->path())
+				&& std::find(ignored_files.begin(), ignored_files.end(), filename) == ignored_files.end()
+				&& it->path().extension() != temp_extension)
 			{
 				std::cerr << "WARNING : file " << it->path() << " not recognized by the resolver" << std::endl;
 			}
@@ -418,23 +497,39 @@ int data_parser::parse_configuration_directory(const astd::filesystem::path& dir
 		++it;
 	}
 
+	result = result | _order_files.load_manifest(directory);
+	_turn = turn != order_file_index::NO_TURN ? turn : _order_files.default_turn();
+	_data.turn = _turn;
+
+	for (const auto& order_path : _order_files.select(_turn))
+	{
+		trace_scope scope("parse_file");
+		scope.set_detail(order_path.filename().generic_string());
+		result = result | parse_order(order_path);
+	}
+
 	return result;
 }
 
-coordinate data_parser::parse_coord_from_value(std::int32_t x, std::int32_t y)
+coordinate data_parser::parse_coord_from_value(std::int64_t x, std::int64_t y)
 {
-	return { x, y, -1 * (x + y) };
+	if (!coordinate::in_range(x, y))
+	{
+		std::cerr << "ERROR : coordinate " << x << ' ' << y << " out of range [" << coordinate::MIN_VALUE << ", " << coordinate::MAX_VALUE << "]" << std::endl;
+		_status |= COORDINATE_OUT_OF_RANGE;
+		return {};
+	}
+	return { static_cast<std::int32_t>(x), static_cast<std::int32_t>(y) };
 }
 
-coordinate data_parser::parse_coord_from_value(std::int32_t x, std::int32_t y, std::int32_t z)
+coordinate data_parser::parse_coord_from_value(std::int64_t x, std::int64_t y, std::int64_t z)
 {
-	coordinate result{ x, y, z };
-	if ((result.x + result.y + result.z) != 0)
+	if ((x + y + z) != 0)
 	{
-		std::cerr << "WARNING : coordinate " << result << " not valid (sum not equal to zero)" << std::endl;
+		std::cerr << "WARNING : coordinate " << x << ' ' << y << ' ' << z << " not valid (sum not equal to zero), z ignored" << std::endl;
 	}
 
-	return result;
+	return parse_coord_from_value(x, y);
 }
 
 coordinate data_parser::parse_coord_from_value(const Json::Value& value)
@@ -447,7 +542,7 @@ coordinate data_parser::parse_coord_from_value(const Json::Value& value)
 	{
 		auto x_it = value.begin();
 		auto y_it = value.begin(); y_it++;
-		result = parse_coord_from_value(x_it->asInt(), y_it->asInt());
+		result = parse_coord_from_value(x_it->asInt64(), y_it->asInt64());
 	}
 
 	if (value.size() == 3)
@@ -455,7 +550,7 @@ coordinate data_parser::parse_coord_from_value(const Json::Value& value)
 		auto x_it = value.begin();
 		auto y_it = value.begin(); y_it++;
 		auto z_it = y_it; z_it++;
-		result = parse_coord_from_value(x_it->asInt(), y_it->asInt(), z_it->asInt());
+		result = parse_coord_from_value(x_it->asInt64(), y_it->asInt64(), z_it->asInt64());
 	}
 
 	if (value.size() != 2 && value.size() != 3)
@@ -4,6 +4,8 @@
 #include "afilesystem.hpp"
 #include "json/json.h"
 #include "data.hpp"
+#include "order_index.hpp"
+#include "reference_index.hpp"
 #include <utility>
 #include <string>
 #include <array>
@@ -17,17 +19,43 @@ public:
       NONE = 0
       , FILE_OPEN_FAILED
       , JSON_PARSING_FAILED
+      , COORDINATE_OUT_OF_RANGE = 4
 
    };
 
-   data_parser(const astd::filesystem::path& directory);
+   //turn : orders to load, order_file_index::NO_TURN selects the turn following the order manifest
+   data_parser(const astd::filesystem::path& directory, std::int32_t turn = order_file_index::NO_TURN);
 
    const game_data& data() const;
 
+   //error_code values of every file parsed, COORDINATE_OUT_OF_RANGE if one of the coordinates doesn't fit in coordinate
+   int status() const;
+
+   //leave the parser without data, turn() and commit_turn() stay valid
    game_data&& get();
 
+   std::int32_t turn() const;
+
+   //mark the parsed turn as consumed so its order files are not loaded again
+   int commit_turn() const;
+
 private:
    game_data _data;
+   astd::filesystem::path _directory;
+   order_file_index _order_files;
+   std::int32_t _turn = order_file_index::NO_TURN;
+   int _status = NONE;
+   reference_index _unit_index;
+
+   //copy the string value in the string pool of _data, without temporary std::string
+   astd::string_view intern_string(const Json::Value& value);
+
+   void set_digest(section_digest::T_section section, std::uint64_t hash);
+
+   //expected_count : number of units about to be looked up, used to size the index once
+   void reserve_units(std::size_t expected_count);
+
+   unit& find_or_insert_unit(const reference& ref);
 
    int parse_def_attack(const astd::filesystem::path& path);
 
@@ -45,13 +73,14 @@ private:
 
    int parse_unit(const astd::filesystem::path& path);
 
-   int parse_configuration_directory(const astd::filesystem::path& directory);
+   int parse_configuration_directory(const astd::filesystem::path& directory, std::int32_t turn);
 
-   static coordinate parse_coord_from_value(std::int32_t x, std::int32_t y);
+   //out of range values set COORDINATE_OUT_OF_RANGE and give the coordinate 0 0
+   coordinate parse_coord_from_value(std::int64_t x, std::int64_t y);
 
-   static coordinate parse_coord_from_value(std::int32_t x, std::int32_t y, std::int32_t z);
+   coordinate parse_coord_from_value(std::int64_t x, std::int64_t y, std::int64_t z);
 
-   static coordinate parse_coord_from_value(const Json::Value&);
+   coordinate parse_coord_from_value(const Json::Value&);
 };
 
 
@@ -0,0 +1,190 @@
+#include "diagnostics.hpp"
+#include "json_writer.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+const char* const diagnostics::filename = "diagnostics.json";
+
+const std::array<const char*, diagnostics::KIND_SIZE> diagnostics::kind_names =
+{ {
+   "terrain_missing",
+   "unit_def_missing",
+   "unit_missing",
+   "attack_missing",
+   "defense_missing",
+   "player_missing",
+   "reference_unknown",
+   "order_unknown",
+   "order_none",
+   "order_not_implemented"
+} };
+
+const std::array<const char*, diagnostics::VERBOSITY_SIZE> diagnostics::verbosity_names =
+{ {
+   "quiet",
+   "summary",
+   "first",
+   "all"
+} };
+
+namespace
+{
+   //references and text details can't collide, the text keys have the top bit set
+   std::uint64_t text_key(astd::string_view str)
+   {
+      std::uint64_t hash = 14695981039346656037ull;
+      for (std::size_t i = 0; i < str.size(); ++i)
+      {
+         hash ^= static_cast<unsigned char>(str[i]);
+         hash *= 1099511628211ull;
+      }
+      return (hash >> 8) | (1ull << 63);
+   }
+}
+
+diagnostics& diagnostics::global()
+{
+   static diagnostics instance;
+   return instance;
+}
+
+bool diagnostics::parse_verbosity(astd::string_view str, T_verbosity& result)
+{
+   auto it = std::find(verbosity_names.begin(), verbosity_names.end(), str);
+   if (it == verbosity_names.end())
+   {
+      return false;
+   }
+   result = static_cast<T_verbosity>(it - verbosity_names.begin());
+   return true;
+}
+
+void diagnostics::set_verbosity(T_verbosity verbosity)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   _verbosity = verbosity;
+}
+
+void diagnostics::report(T_kind kind, const reference& ref)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   bool inserted = false;
+   auto& current = find_or_insert(kind, (std::uint64_t(kind) << 32) | ref.packed(), inserted);
+   if (inserted)
+   {
+      current.ref = ref;
+   }
+   if (_verbosity == ALL || (inserted && _verbosity == FIRST))
+   {
+      echo(current);
+   }
+}
+
+void diagnostics::report(T_kind kind, astd::string_view detail)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   bool inserted = false;
+   auto& current = find_or_insert(kind, text_key(detail) ^ (std::uint64_t(kind) << 48), inserted);
+   if (inserted)
+   {
+      current.detail.assign(detail.data(), detail.size());
+   }
+   if (_verbosity == ALL || (inserted && _verbosity == FIRST))
+   {
+      echo(current);
+   }
+}
+
+std::uint64_t diagnostics::total() const
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   return _total;
+}
+
+void diagnostics::print_summary(const astd::filesystem::path& file) const
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   if (_verbosity != QUIET && _total)
+   {
+      std::cerr << "WARNING : " << _total << " warnings (" << _entries.size() << " distinct), see " << file << '\n';
+   }
+}
+
+int diagnostics::dump(const astd::filesystem::path& path) const
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   std::vector<const entry*> sorted;
+   sorted.reserve(_entries.size());
+   for (const auto& pair : _entries)
+   {
+      sorted.push_back(&pair.second);
+   }
+   std::sort(sorted.begin(), sorted.end(), [](const entry* lval, const entry* rval)
+   {
+      return std::tie(lval->kind, lval->ref, lval->detail) < std::tie(rval->kind, rval->ref, rval->detail);
+   });
+
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
+   if (!stream)
+   {
+      return OPEN_FILE;
+   }
+
+   json_writer writer(stream);
+   writer.begin_object();
+   writer.key("diagnostics").begin_array();
+   for (const auto* current : sorted)
+   {
+      writer.begin_object();
+      writer.key("count").value(std::int64_t(current->count));
+      if (!current->detail.empty())
+      {
+         writer.key("detail").value(astd::string_view(current->detail.data(), current->detail.size()));
+      }
+      writer.key("kind").value(kind_names[current->kind]);
+      if (current->ref.type() != reference::NUL)
+      {
+         writer.key("ref").value(current->ref);
+      }
+      writer.end_object();
+   }
+   writer.end_array();
+   writer.key("total").value(std::int64_t(_total));
+   writer.end_object();
+   return writer.flush() ? NONE : OPEN_FILE;
+}
+
+void diagnostics::clear()
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   _entries.clear();
+   _total = 0;
+}
+
+diagnostics::entry& diagnostics::find_or_insert(T_kind kind, std::uint64_t key, bool& inserted)
+{
+   ++_total;
+   auto result = _entries.emplace(key, entry());
+   inserted = result.second;
+   auto& current = result.first->second;
+   current.kind = kind;
+   ++current.count;
+   return current;
+}
+
+void diagnostics::echo(const entry& current) const
+{
+   std::cerr << "WARNING : " << kind_names[current.kind];
+   if (current.ref.type() != reference::NUL)
+   {
+      std::cerr << " - ref " << current.ref;
+   }
+   if (!current.detail.empty())
+   {
+      std::cerr << " - " << current.detail;
+   }
+   std::cerr << '\n';
+}
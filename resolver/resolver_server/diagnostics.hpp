@@ -0,0 +1,93 @@
+#ifndef DIAGNOSTICS_HPP
+#define DIAGNOSTICS_HPP
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "afilesystem.hpp"
+#include "astring_view.hpp"
+#include "reference.hpp"
+
+// warnings of the parsing and resolution, counted once per (kind, reference) instead of
+// being written to std::cerr on every miss : a malformed game file can miss millions of times
+// verbosity only changes what is echoed on std::cerr, diagnostics.json always has everything
+class diagnostics
+{
+public:
+   enum T_kind
+   {
+      TERRAIN_MISSING,
+      UNIT_DEF_MISSING,
+      UNIT_MISSING,
+      ATTACK_MISSING,
+      DEFENSE_MISSING,
+      PLAYER_MISSING,
+      REFERENCE_UNKNOWN,
+      ORDER_UNKNOWN,
+      ORDER_NONE,
+      ORDER_NOT_IMPLEMENTED,
+      KIND_SIZE
+   };
+
+   enum T_verbosity
+   {
+      QUIET, //nothing on std::cerr
+      SUMMARY, //the amount of warnings once the turn is done
+      FIRST, //first occurrence of every (kind, reference), then the summary
+      ALL, //every occurrence, then the summary
+      VERBOSITY_SIZE
+   };
+
+   enum error_code : int
+   {
+      NONE = 0,
+      OPEN_FILE = 1
+   };
+
+   static const char* const filename;
+   static const std::array<const char*, KIND_SIZE> kind_names;
+   static const std::array<const char*, VERBOSITY_SIZE> verbosity_names;
+
+   //shared by the parser, the resolver and order::parse
+   static diagnostics& global();
+
+   //return false for an unknown name
+   static bool parse_verbosity(astd::string_view str, T_verbosity& result);
+
+   void set_verbosity(T_verbosity verbosity);
+
+   void report(T_kind kind, const reference& ref);
+   //for the warnings without a reference, the detail is the key
+   void report(T_kind kind, astd::string_view detail);
+
+   std::uint64_t total() const;
+
+   //write the diagnostics at path, diagnostics::filename in the output directory
+   int dump(const astd::filesystem::path& path) const;
+
+   //print the amount of warnings according to the verbosity, file is where they were dumped
+   void print_summary(const astd::filesystem::path& file) const;
+
+   void clear();
+
+private:
+   struct entry
+   {
+      T_kind kind = KIND_SIZE;
+      reference ref;
+      std::string detail;
+      std::uint64_t count = 0;
+   };
+
+   mutable std::mutex _mutex;
+   std::unordered_map<std::uint64_t, entry> _entries;
+   std::uint64_t _total = 0;
+   T_verbosity _verbosity = FIRST;
+
+   entry& find_or_insert(T_kind kind, std::uint64_t key, bool& inserted);
+   void echo(const entry& current) const;
+};
+
+#endif //!DIAGNOSTICS_HPP
@@ -9,7 +9,24 @@
 #include <limits>
 #include <functional>
 #include <cassert>
+#include <cmath>
+#include <tuple>
 #include "boost/container/flat_map.hpp"
+#include "trace_recorder.hpp"
+#include "diagnostics.hpp"
+#include "task_scheduler.hpp"
+
+namespace
+{
+	//orders unit indices on the position of their unit, for equal_range on a tile
+	struct tile_compare
+	{
+		const std::vector<unit>& units;
+
+		bool operator()(std::uint32_t index, const coordinate& tile) const { return units[index].pos < tile; }
+		bool operator()(const coordinate& tile, std::uint32_t index) const { return tile < units[index].pos; }
+	};
+}
 
 const std::array<int (game_resolver::*)(unit& source, const order& order), order::SIZE> game_resolver::order_state_machine
 =
@@ -22,9 +39,8 @@ const std::array<int (game_resolver::*)(unit& source, const order& order), order
 
 const terrain game_resolver::bad_terrain_value;
 const coordinate game_resolver::bad_coordinate_value
-{ std::numeric_limits<int>::min()
-, std::numeric_limits<int>::min()
-, std::numeric_limits<int>::min() };
+{ std::numeric_limits<std::int16_t>::min()
+, std::numeric_limits<std::int16_t>::min() };
 
 const unit_definition game_resolver::bad_unit_def_value;
 const unit_action game_resolver::bad_unit_action;
@@ -32,10 +48,22 @@ unit game_resolver::bad_unit_value;
 const player game_resolver::bad_player;
 
 
-game_resolver::game_resolver(const game_data& game)
-	: _data(game)
+game_resolver::game_resolver(const game_data& game, bool resolve_now, const resolver_options& options)
+	: game_resolver(game_data(game), resolve_now, options)
+{}
+
+game_resolver::game_resolver(game_data&& game, bool resolve_now, const resolver_options& options)
+	: _data(std::move(game)), _options(options)
 {
-	resolve();
+	if (link_references(_data))
+	{
+		_status |= REF_MISSING;
+	}
+	_damage.build(_data);
+	if (resolve_now)
+	{
+		resolve();
+	}
 }
 
 const game_data& game_resolver::data() const
@@ -53,19 +81,64 @@ int game_resolver::status() const
 	return _status;
 }
 
+const resolver_stats& game_resolver::stats() const
+{
+	return _stats;
+}
+
+const turn_journal& game_resolver::journal() const
+{
+	return _journal;
+}
+
+bool game_resolver::can_execute_order(const unit& unit) const
+{
+	return unit.actions.size()
+		&& !unit.action_invalid
+		&& unit.action_point_remaining >= action_cost(unit.actions.front());
+}
+
 boost::optional<unit&> game_resolver::find_first_valid_order()
 {
-	sort_unit_per_point();
-	auto it = std::find_if(_data.units.begin(), _data.units.end(),
-		[this](const unit& unit)
+	//a unit in _order_queue only changes when it executes an order : the units are sorted
+	//once, then only the top of the queue is checked, and queued again when it changed
+	if (_order_queue_dirty)
 	{
-		return unit.actions.size() 
-			&& !unit.action_invalid 
-			&& unit.action_point_remaining >= action_cost(unit.actions.front());
-	});
-	if (it != _data.units.end())
+		sort_unit_per_point();
+		_order_queue.clear();
+		for (auto index : _unit_order)
+		{
+			const auto& unit = _data.units[index];
+			if (can_execute_order(unit))
+				_order_queue.push_back({ unit.action_point_remaining, index });
+		}
+		_order_queue_dirty = false;
+	}
+
+	//the sorted queue is a heap already : most action points first, then the lowest id
+	auto lower_priority = [this](const queued_order& lval, const queued_order& rval)
 	{
-		return *it;
+		if (lval.action_points != rval.action_points)
+			return lval.action_points < rval.action_points;
+		return _data.units[rval.index].id < _data.units[lval.index].id;
+	};
+	while (!_order_queue.empty())
+	{
+		auto top = _order_queue.front();
+		auto& unit = _data.units[top.index];
+		bool valid = can_execute_order(unit);
+		if (valid && top.action_points == unit.action_point_remaining)
+		{
+			return unit;
+		}
+
+		std::pop_heap(_order_queue.begin(), _order_queue.end(), lower_priority);
+		_order_queue.pop_back();
+		if (valid)
+		{
+			_order_queue.push_back({ unit.action_point_remaining, top.index });
+			std::push_heap(_order_queue.begin(), _order_queue.end(), lower_priority);
+		}
 	}
 	return {};
 }
@@ -76,30 +149,95 @@ float game_resolver::action_cost(const order& acc) const
 	if (acc.type == order::FIRE) return get_attack_cost(acc);
 	if (acc.type == order::BUILD) return 0;
 	if (acc.type == order::NONE)
-		std::cerr << "WARNING : Order NONE detected" << std::endl;
+		diagnostics::global().report(diagnostics::ORDER_NONE, "cost of a NONE order");
 	return 0;
 
 }
 
 float game_resolver::get_attack_cost(const order& acc) const
 {
-	auto& att = get_attack(acc.modifier);
+	auto& att = attack_at(acc.modifier_index);
 	return static_cast<float>(att.cost);
 }
 
 void game_resolver::sort_unit_per_point()
 {
-	std::sort(_data.units.begin(), _data.units.end(), [](auto& lval, auto& rval)
+	//the unit ids are the tie key of the radix sort, equal action points are ordered on them
+	_action_points.resize(_data.units.size());
+	_unit_ids.resize(_data.units.size());
+	for (std::size_t i = 0; i < _data.units.size(); ++i)
 	{
-		return lval.action_point_remaining > rval.action_point_remaining;
-	});
+		_action_points[i] = _data.units[i].action_point_remaining;
+		_unit_ids[i] = _data.units[i].id.packed();
+	}
+	_sorter.sort_descending(_action_points.data(), _unit_ids.data(), _action_points.size(), _unit_order);
+}
+
+const std::vector<std::uint32_t>& game_resolver::unit_order() const
+{
+	return _unit_order;
 }
 
 void game_resolver::resolve()
 {
-	for (auto& unit : _data.units)
 	{
-		unit.action_point_remaining = static_cast<float>(get_unit_def(unit.type).action_point);
+		RESOLVER_STATS_PHASE(_stats, ACTION_POINTS);
+		if (_options.morton_order)
+			sort_units_spatially();
+		initialize_action_points();
+	}
+	{
+		RESOLVER_STATS_PHASE(_stats, ORDERS);
+		execute_orders();
+	}
+	{
+		RESOLVER_STATS_PHASE(_stats, DEAD_AFTER_ORDERS);
+		bring_out_the_dead();
+		if (_options.morton_order)
+			sort_units_spatially();
+	}
+	{
+		RESOLVER_STATS_PHASE(_stats, CLOSE_COMBAT);
+		close_combat_action();
+	}
+	{
+		RESOLVER_STATS_PHASE(_stats, DEAD_AFTER_CLOSE_COMBAT);
+		bring_out_the_dead();
+		if (_options.morton_order)
+			sort_units_spatially();
+	}
+
+	//the parallel_for bodies took their temporaries from the arena of the thread they ran on
+	task_scheduler::global().for_each_thread([](std::size_t) { turn_arena::local().release(); });
+}
+
+void game_resolver::initialize_action_points()
+{
+	task_scheduler::global().parallel_for(0, _data.units.size(), 4096, [this](std::size_t i)
+	{
+		auto& unit = _data.units[i];
+		unit.action_point_remaining = static_cast<float>(get_unit_def(unit).action_point);
+	});
+	_order_queue_dirty = true;
+}
+
+void game_resolver::sort_units_spatially()
+{
+	std::stable_sort(_data.units.begin(), _data.units.end(), [](const unit& lval, const unit& rval)
+	{
+		return morton_key(lval.pos) < morton_key(rval.pos);
+	});
+	_order_queue_dirty = true;
+}
+
+void game_resolver::execute_orders()
+{
+	if (_options.batched_orders)
+	{
+		while (execute_move_batch());
+		while (execute_fire_batch());
+		while (execute_other_batch());
+		return;
 	}
 
 	for (auto unit = find_first_valid_order(); 
@@ -107,19 +245,190 @@ void game_resolver::resolve()
 		unit = find_first_valid_order())
 	{
 		auto& unit_ref = unit.value();
-		if (execute_order(unit_ref, unit_ref.actions.front()) != 0)
+		trace_scope scope("order");
+		if (scope.active())
 		{
-			unit_ref.action_invalid = true;
+			const auto& ord = unit_ref.actions.front();
+			scope.set_ref(unit_ref.id);
+			scope.set_label(order::serialize(ord.type).data());
+			scope.set_position(ord.target.x, ord.target.y);
+			scope.set_value(action_cost(ord));
 		}
-		else
+		finish_order(unit_ref, execute_order(unit_ref, unit_ref.actions.front()));
+	}
+}
+
+void game_resolver::finish_order(unit& source, int result)
+{
+	RESOLVER_STATS_ORDER(_stats, source.actions.front().type, result != 0);
+	if (result != 0)
+	{
+		_journal.order_rejected(source.id, source.actions.front());
+		source.action_invalid = true;
+	}
+	else
+	{
+		source.actions.pop_front();
+	}
+}
+
+void game_resolver::collect_batch(std::uint32_t type_mask, arena_vector<std::uint32_t>& batch) const
+{
+	batch.clear();
+	for (std::uint32_t i = 0; i < _data.units.size(); ++i)
+	{
+		const auto& unit = _data.units[i];
+		if (can_execute_order(unit) && (type_mask >> unit.actions.front().type) & 1u)
+		{
+			batch.push_back(i);
+		}
+	}
+	//the rounds run in id order, whatever the order of _data.units
+	std::sort(batch.begin(), batch.end(), [this](std::uint32_t lval, std::uint32_t rval)
+	{
+		return _data.units[lval].id < _data.units[rval].id;
+	});
+}
+
+bool game_resolver::execute_move_batch()
+{
+	//a phase runs as many rounds as the longest order queue, each round gives back its temporaries
+	turn_arena::scope temporaries;
+	arena_vector<std::uint32_t> batch;
+	collect_batch(1u << order::MOVE, batch);
+	if (batch.empty())
+		return false;
+
+	trace_scope scope("move_batch");
+	scope.set_value(static_cast<float>(batch.size()));
+
+	//validation and cost deduction, a move only reads the map and writes its own unit
+	arena_vector<std::uint8_t> accepted(batch.size(), 0);
+	task_scheduler::global().parallel_for(0, batch.size(), 256, [&](std::size_t i)
+	{
+		auto& source = _data.units[batch[i]];
+		const auto& target = source.actions.front().target;
+		auto nearby = neighbors(source.pos);
+		if (std::find(nearby.begin(), nearby.end(), target) != nearby.end())
+		{
+			source.pos = target;
+			source.action_point_remaining -= get_movement_cost(target);
+			accepted[i] = 1;
+		}
+	});
+
+	for (std::size_t i = 0; i < batch.size(); ++i)
+	{
+		auto& source = _data.units[batch[i]];
+		if (accepted[i])
+			_journal.move(source.id, source.pos);
+		finish_order(source, accepted[i] ? NONE : ORDER_REFUSED);
+	}
+	return true;
+}
+
+bool game_resolver::execute_fire_batch()
+{
+	turn_arena::scope temporaries;
+	arena_vector<std::uint32_t> batch;
+	collect_batch(1u << order::FIRE, batch);
+	if (batch.empty())
+		return false;
+
+	trace_scope scope("fire_batch");
+	scope.set_value(static_cast<float>(batch.size()));
+
+	//every shot of the round reads the endurance of the beginning of the round,
+	//damages are summed apart and applied once the round is over
+	arena_vector<std::int32_t> endurance(_data.units.size());
+	std::transform(_data.units.begin(), _data.units.end(), endurance.begin(), [](const unit& unit) { return unit.endurance; });
+
+	//unit indices sorted on their tile, the targets of a shot are one equal range
+	arena_vector<std::uint32_t> per_tile(_data.units.size());
+	std::iota(per_tile.begin(), per_tile.end(), 0u);
+	std::sort(per_tile.begin(), per_tile.end(), [this](std::uint32_t lval, std::uint32_t rval)
+	{
+		const auto& lpos = _data.units[lval].pos;
+		const auto& rpos = _data.units[rval].pos;
+		return lpos < rpos || (lpos == rpos && _data.units[lval].id < _data.units[rval].id);
+	});
+	auto tile_range = [this, &per_tile](const coordinate& tile)
+	{
+		return std::equal_range(per_tile.begin(), per_tile.end(), tile, tile_compare{ _data.units });
+	};
+
+	//attack selection and cost, a shot only writes its own slots and the action points of its unit
+	//NO_INDEX with NONE : the unit is too weak to fire, the order is consumed
+	arena_vector<std::uint32_t> attack(batch.size(), NO_INDEX);
+	arena_vector<int> result(batch.size(), NONE);
+	task_scheduler::global().parallel_for(0, batch.size(), 256, [&](std::size_t i)
+	{
+		auto& source = _data.units[batch[i]];
+		const auto& target = source.actions.front().target;
+		if (endurance[batch[i]] < 20)
+			return;
+
+		auto dis = distance(source.pos, target);
+		if (!range_contains(get_unit_def(source).attack_range, dis))
+		{
+			result[i] = ORDER_REFUSED;
+			return;
+		}
+
+		auto targets = tile_range(target);
+		auto first_target = std::find_if(targets.first, targets.second, [&batch, i](std::uint32_t index) { return index != batch[i]; });
+		attack[i] = select_attack(source, dis,
+			first_target != targets.second ? &_data.units[*first_target] : nullptr, _data.current_map.terrain_index(target));
+		if (attack[i] == NO_INDEX)
 		{
-			unit_ref.actions.pop_front();
-		}		
+			result[i] = ORDER_REFUSED;
+			return;
+		}
+		pay_attack(source, attack_at(attack[i]));
+	});
+
+	arena_vector<std::int32_t> damage(_data.units.size(), 0);
+	for (std::size_t i = 0; i < batch.size(); ++i)
+	{
+		auto& source = _data.units[batch[i]];
+		if (attack[i] != NO_INDEX)
+		{
+			const auto& target = source.actions.front().target;
+			auto terrain_index = _data.current_map.terrain_index(target);
+			_journal.shot(source.id, attack_at(attack[i]).id, target);
+			auto targets = tile_range(target);
+			for (auto it = targets.first; it != targets.second; ++it)
+			{
+				auto dealt = attack_damage(attack[i], endurance[batch[i]], _data.units[*it], terrain_index);
+				damage[*it] += dealt;
+				if (dealt)
+					_journal.damage(_data.units[*it].id, source.id, static_cast<std::int32_t>(dealt));
+			}
+		}
+		finish_order(source, result[i]);
 	}
 
-	bring_out_the_dead();
-	close_combat_action();
-	bring_out_the_dead();
+	for (std::size_t i = 0; i < _data.units.size(); ++i)
+	{
+		_data.units[i].endurance -= damage[i];
+	}
+	return true;
+}
+
+bool game_resolver::execute_other_batch()
+{
+	turn_arena::scope temporaries;
+	arena_vector<std::uint32_t> batch;
+	collect_batch(~((1u << order::MOVE) | (1u << order::FIRE)), batch);
+	if (batch.empty())
+		return false;
+
+	for (auto index : batch)
+	{
+		auto& source = _data.units[index];
+		finish_order(source, execute_order(source, source.actions.front()));
+	}
+	return true;
 }
 
 int game_resolver::execute_order(unit& source, const order& order)
@@ -129,7 +438,7 @@ int game_resolver::execute_order(unit& source, const order& order)
 
 int game_resolver::execute_none(unit& source, const order& order)
 {
-	std::cerr << "WARNING : trying to execute none order - ref:" << order.type << std::endl;
+	diagnostics::global().report(diagnostics::ORDER_NONE, source.id);
 	return 0;
 }
 
@@ -142,6 +451,7 @@ int game_resolver::execute_move(unit& source, const order& order)
 	{
 		source.pos = order.target;
 		source.action_point_remaining -= get_movement_cost(order);
+		_journal.move(source.id, order.target);
 	}
 	else
 	{
@@ -150,49 +460,68 @@ int game_resolver::execute_move(unit& source, const order& order)
 	return result;
 }
 
-unit_action game_resolver::calculate_unit_defense(const unit_definition& unit_def) const
-{
-	unit_action result;
-
-	for (const auto& ref : unit_def.defense)
-	{
-		const auto& def = get_defense(ref);
-		result.hard += def.hard;
-		result.soft += def.soft;
-	}
-	return result;
-}
-
 int game_resolver::execute_fire(unit& source, const order& order)
 {
 	return try_attack(source, order.target, true);
 }
 
-int game_resolver::try_attack(unit& attacker_unit, const coordinate& target, const unit_action& att, bool friendly_fire)
+int game_resolver::try_attack(unit& attacker_unit, const coordinate& target, std::uint32_t attack_index, bool friendly_fire)
 {
-	const auto& terrain = get_terrain(target);
-	auto attacking_team = get_player(attacker_unit.owner).team;
+	const auto& att = attack_at(attack_index);
+	auto terrain_index = _data.current_map.terrain_index(target);
+	auto attacking_team = get_player(attacker_unit).team;
+	_journal.shot(attacker_unit.id, att.id, target);
+
+	//the damages are journaled in id order, whatever the order of _data.units
+	turn_arena::scope temporaries;
+	arena_vector<std::reference_wrapper<unit>> targets;
+	for_each_unit(target, [&](unit& targeted_unit)
+	{
+		if (friendly_fire || (get_player(targeted_unit).team != attacking_team))
+			targets.push_back(targeted_unit);
+	});
+	std::sort(targets.begin(), targets.end(), [](const unit& lval, const unit& rval) { return lval.id < rval.id; });
 
-	for (auto& targeted_unit : get_units(target))
+	for (unit& targeted_unit : targets)
 	{
-		if (friendly_fire || (get_player(targeted_unit.get().owner).team != attacking_team))
-		{
-			const auto& target_def = get_unit_def(targeted_unit.get().type);
-			auto unit_targeted_def = calculate_unit_defense(target_def);
-			float floating_damage = std::max((att.soft - (unit_targeted_def.soft * terrain.cover * target_def.cover_usage))
-				+ (att.hard - (unit_targeted_def.hard * terrain.cover * target_def.cover_usage)), 0.f);
-			if (attacker_unit.endurance < 80)
-				floating_damage = floating_damage * attacker_unit.endurance / 100;
-			targeted_unit.get().endurance -= static_cast<std::uint32_t>(std::floor(floating_damage));
-		}
+		auto damage = attack_damage(attack_index, attacker_unit.endurance, targeted_unit, terrain_index);
+		targeted_unit.endurance -= damage;
+		if (damage)
+			_journal.damage(targeted_unit.id, attacker_unit.id, static_cast<std::int32_t>(damage));
 	}
 
+	pay_attack(attacker_unit, att);
+	return NONE;
+}
+
+std::uint32_t game_resolver::attack_damage(std::uint32_t attack_index, std::int32_t attacker_endurance, const unit& target, std::uint32_t terrain_index) const
+{
+	float floating_damage = _damage.base(attack_index, target.type_index, terrain_index);
+	if (attacker_endurance < 80)
+		floating_damage = floating_damage * attacker_endurance / 100;
+	return static_cast<std::uint32_t>(std::floor(floating_damage));
+}
+
+void game_resolver::pay_attack(unit& attacker_unit, const unit_action& att)
+{
 	if (att.cost >= 0)
 		attacker_unit.action_point_remaining -= att.cost;
 	else
 		attacker_unit.action_point_remaining = 0;
+}
 
-	return NONE;
+std::uint32_t game_resolver::select_attack(const unit& attacker_unit, std::uint32_t dis, const unit* first_target, std::uint32_t terrain_index) const
+{
+	const auto& candidates = first_target
+		? _damage.ranked(attacker_unit.type_index, first_target->type_index, terrain_index)
+		: get_unit_def(attacker_unit).attack_index;
+
+	auto att_it = std::find_if(candidates.begin(), candidates.end(), [&dis, acc = attacker_unit.action_point_remaining, this](std::uint32_t index) {
+		auto& att = attack_at(index);
+		bool point_ok = att.cost > 0 ? att.cost < acc : acc > 0;
+		return point_ok && attack_in_range(att, dis);
+	});
+	return att_it != candidates.end() ? *att_it : std::uint32_t(NO_INDEX);
 }
 
 
@@ -203,13 +532,13 @@ int game_resolver::try_attack(unit& source, const order ord)
 	if (source.endurance < 20)
 		return result;
 
-	auto& unit_def = get_unit_def(source.type);
+	auto& unit_def = get_unit_def(source);
 	if (std::find(unit_def.attack.begin(), unit_def.attack.end(), ord.modifier) == unit_def.attack.end())
 	{
 		result = ORDER_REFUSED;
 	}
 
-	auto& attack_def = get_attack(ord.modifier);
+	auto& attack_def = attack_at(ord.modifier_index);
 	auto dis = distance(source.pos, ord.target);
 	if (!attack_in_range(attack_def, dis))
 	{
@@ -218,7 +547,7 @@ int game_resolver::try_attack(unit& source, const order ord)
 
 	if (result == NONE)
 	{
-		result = try_attack(source, ord.target, attack_def, dis != 0);
+		result = try_attack(source, ord.target, ord.modifier_index, dis != 0);
 	}
 
 	return result;
@@ -226,7 +555,7 @@ int game_resolver::try_attack(unit& source, const order ord)
 
 bool game_resolver::attack_in_range(const unit_action& attack_def, uint32_t distance) const 
 {
-	return attack_def.range[0] <= distance && attack_def.range[1] >= distance;
+	return range_contains(attack_def.range, distance);
 }
 
 int game_resolver::try_attack(unit& attacker_unit, const coordinate& target, bool friendly_fire)
@@ -236,17 +565,24 @@ int game_resolver::try_attack(unit& attacker_unit, const coordinate& target, boo
 	if (attacker_unit.endurance < 20)
 		return result;
 
-	auto& attacker_def = get_unit_def(attacker_unit.type);
+	auto& attacker_def = get_unit_def(attacker_unit);
 	auto dis = distance(attacker_unit.pos, target);
-	auto att_it = std::find_if(attacker_def.attack.begin(), attacker_def.attack.end(), [&dis, acc = attacker_unit.action_point_remaining, this](const auto& ref) {
-		auto& att = get_attack(ref);
-		bool point_ok = att.cost > 0 ? att.cost < acc : acc > 0;
-		return point_ok && attack_in_range(att, dis);
-	});
+	if (!range_contains(attacker_def.attack_range, dis))
+		return ORDER_REFUSED;
 
-	if (att_it != attacker_def.attack.end())
+	//the attacks are tried from the most damaging against the unit of lowest id hit on the tile
+	auto attacking_team = get_player(attacker_unit).team;
+	const unit* first_target = nullptr;
+	for_each_unit(target, [&](const unit& targeted_unit)
 	{
-		return try_attack(attacker_unit, target, get_attack(*att_it), friendly_fire);
+		if (&targeted_unit != &attacker_unit && (friendly_fire || get_player(targeted_unit).team != attacking_team)
+			&& (!first_target || targeted_unit.id < first_target->id))
+			first_target = &targeted_unit;
+	});
+	auto attack_index = select_attack(attacker_unit, dis, first_target, _data.current_map.terrain_index(target));
+	if (attack_index != NO_INDEX)
+	{
+		return try_attack(attacker_unit, target, attack_index, friendly_fire);
 	}
 	result = ORDER_REFUSED;
 	return result;
@@ -256,90 +592,210 @@ int game_resolver::try_attack(unit& attacker_unit, const coordinate& target, boo
 
 int game_resolver::execute_build(unit& source, const order& order)
 {
-	std::cerr << "WARNING : BUILD action not yet implemented - source " << source.id << std::endl;
+	diagnostics::global().report(diagnostics::ORDER_NOT_IMPLEMENTED, source.id);
 	return 1;
 }
 
 int game_resolver::close_combat_action()
 {
-	boost::container::flat_map<coordinate, std::vector<std::reference_wrapper<unit>>> unit_per_case;
-	unit_per_case.reserve(_data.units.size() / 2);
+	//units grouped per tile by sorting a single buffer on their position then their id
+	//the tiles, their fights and retreats come in the same order whatever the order of _data.units
+	arena_vector<std::reference_wrapper<unit>> units_per_case(_data.units.begin(), _data.units.end());
+	std::sort(units_per_case.begin(), units_per_case.end(), [](const auto& lval, const auto& rval)
+	{
+		const auto& lunit = lval.get();
+		const auto& runit = rval.get();
+		return lunit.pos < runit.pos || (lunit.pos == runit.pos && lunit.id < runit.id);
+	});
 
-	for (auto& unit : _data.units)
+	//tiles holding more than one unit, as [first, last) ranges of units_per_case
+	struct shared_tile
+	{
+		std::size_t first;
+		std::size_t last;
+		bool contested;
+	};
+	arena_vector<shared_tile> shared_tiles;
+	std::size_t first_index = 0;
+	while (first_index != units_per_case.size())
 	{
-		unit_per_case[unit.pos].push_back(unit);
+		const coordinate tile = units_per_case[first_index].get().pos;
+		auto last_index = first_index + 1;
+		while (last_index != units_per_case.size() && units_per_case[last_index].get().pos == tile)
+			++last_index;
+
+		if (last_index - first_index > 1)
+		{
+			auto first_team = get_player(units_per_case[first_index].get()).team;
+			bool contested = std::any_of(units_per_case.begin() + first_index + 1, units_per_case.begin() + last_index, [first_team, this](const auto& unit)
+			{
+				return get_player(unit.get()).team != first_team;
+			});
+			shared_tiles.push_back({ first_index, last_index, contested });
+		}
+		first_index = last_index;
 	}
 
-	for (auto& pair : unit_per_case)
+	//double buffered fights : every unit attacks with the endurance it has at the beginning of the fight,
+	//damages are summed apart and applied once every contested tile is resolved
+	//a fight only touches the buffer slots of its tile and the action points of its units, so they run in parallel
+	arena_vector<std::int32_t> endurance(units_per_case.size());
+	arena_vector<std::int32_t> damage(units_per_case.size(), 0);
+	arena_vector<std::uint32_t> attack(units_per_case.size(), NO_INDEX);
+	std::transform(units_per_case.begin(), units_per_case.end(), endurance.begin(), [](const auto& unit) { return unit.get().endurance; });
+
+	task_scheduler::global().parallel_for(0, shared_tiles.size(), 32, [&](std::size_t i)
 	{
-		if (pair.second.size() > 1)
+		const auto& shared = shared_tiles[i];
+		if (shared.contested)
 		{
-			std::set<char> teams;
+			fight(units_per_case.data() + shared.first, shared.last - shared.first,
+				endurance.data() + shared.first, damage.data() + shared.first, attack.data() + shared.first);
+		}
+	});
 
-			for (auto& unit : pair.second)
-			{
-				teams.insert(get_player(unit.get().owner).team);
-			}
-			if (teams.size() > 1)
-			{
-				for (auto& unit : pair.second)
-				{
-					try_attack(unit.get(), pair.first, false);
-				}
-			}
+	for (const auto& shared : shared_tiles)
+	{
+		if (shared.contested)
+		{
+			apply_fight(units_per_case.data() + shared.first, shared.last - shared.first,
+				endurance.data() + shared.first, damage.data() + shared.first, attack.data() + shared.first);
+		}
+	}
+
+	for (const auto& shared : shared_tiles)
+	{
+		auto first = units_per_case.begin() + shared.first;
+		auto last = units_per_case.begin() + shared.last;
+		const coordinate tile = first->get().pos;
 
-			std::sort(pair.second.begin(), pair.second.end(), [](const auto& lval, const auto& rval)
+		std::sort(first, last, [](const auto& lval, const auto& rval)
+		{
+			const auto& lunit = lval.get();
+			const auto& runit = rval.get();
+			if (lunit.endurance != runit.endurance)
+				return lunit.endurance > runit.endurance;
+			if (lunit.action_point_remaining != runit.action_point_remaining)
+				return lunit.action_point_remaining > runit.action_point_remaining;
+			return lunit.id < runit.id;
+		});
+
+		auto neigh = neighbors(tile);
+		while (last - first > 1)
+		{
+			auto& retreating = (last - 1)->get();
+			auto& pla = get_player(retreating);
+			std::sort(neigh.begin(), neigh.end(), [&pla, this](const auto& lval, const auto& rval)
 			{
-				bool result = lval.get().endurance > rval.get().endurance;
-				if (lval.get().endurance == rval.get().endurance)
-					result = lval.get().action_point_remaining > rval.get().action_point_remaining;
-				return result;
+				return distance(lval, pla.rally_point[0]) < distance(rval, pla.rally_point[0]);
 			});
 
-			auto neigh = neighbors(pair.first);
-			while (pair.second.size() > 1)
+			auto it = std::find_if_not(neigh.begin(), neigh.end(), [this](const auto& val) { return has_unit(val); });
+			if (it != neigh.end())
 			{
-				auto& pla = get_player(pair.second.back().get().owner);
-				std::sort(neigh.begin(), neigh.end(), [&pla, this](const auto& lval, const auto& rval)
-				{
-					return distance(lval, pla.rally_point[0]) < distance(rval, pla.rally_point[0]);
-				});
-
-				auto it = std::find_if_not(neigh.begin(), neigh.end(), [this](const auto& val) { return has_unit(val); });
-				if (it != neigh.end())
-					pair.second.back().get().pos = *it;
-				else
-					pair.second.back().get().endurance = 0;
-				pair.second.pop_back();
+				retreating.pos = *it;
+				_journal.retreat(retreating.id, *it);
 			}
+			else
+				retreating.endurance = 0;
+			--last;
 		}
 	}
 
 	return NONE;
 }
 
+void game_resolver::fight(std::reference_wrapper<unit>* units, std::size_t size, const std::int32_t* endurance, std::int32_t* damage, std::uint32_t* attack)
+{
+	const coordinate tile = units[0].get().pos;
+	auto terrain_index = _data.current_map.terrain_index(tile);
+	RESOLVER_STATS_COUNT(CONTESTED_TILES);
+	trace_scope scope("contested_tile");
+	scope.set_position(tile.x, tile.y);
+	scope.set_value(static_cast<float>(size));
+
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		auto& attacker_unit = units[i].get();
+		if (endurance[i] < 20 || !range_contains(get_unit_def(attacker_unit).attack_range, 0))
+			continue;
+
+		auto attacking_team = get_player(attacker_unit).team;
+		auto first_target = std::find_if(units, units + size, [attacking_team, this](const auto& targeted_unit)
+		{
+			return get_player(targeted_unit.get()).team != attacking_team;
+		});
+		attack[i] = select_attack(attacker_unit, 0, first_target != units + size ? &first_target->get() : nullptr, terrain_index);
+		if (attack[i] == NO_INDEX)
+			continue;
+
+		for (std::size_t j = 0; j < size; ++j)
+		{
+			if (get_player(units[j].get()).team != attacking_team)
+				damage[j] += attack_damage(attack[i], endurance[i], units[j].get(), terrain_index);
+		}
+		pay_attack(attacker_unit, attack_at(attack[i]));
+	}
+}
+
+void game_resolver::apply_fight(std::reference_wrapper<unit>* units, std::size_t size, const std::int32_t* endurance, const std::int32_t* damage, const std::uint32_t* attack)
+{
+	//the journal is written here, in tile order, so fight stays free of shared writes
+	const coordinate tile = units[0].get().pos;
+	auto terrain_index = _data.current_map.terrain_index(tile);
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		if (attack[i] == NO_INDEX)
+			continue;
+
+		const auto& attacker_unit = units[i].get();
+		auto attacking_team = get_player(attacker_unit).team;
+		_journal.shot(attacker_unit.id, attack_at(attack[i]).id, tile);
+		for (std::size_t j = 0; j < size; ++j)
+		{
+			if (get_player(units[j].get()).team == attacking_team)
+				continue;
+			auto dealt = attack_damage(attack[i], endurance[i], units[j].get(), terrain_index);
+			if (dealt)
+				_journal.damage(units[j].get().id, attacker_unit.id, static_cast<std::int32_t>(dealt));
+		}
+	}
+
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		units[i].get().endurance -= damage[i];
+	}
+}
+
 void game_resolver::bring_out_the_dead()
 {
-	std::sort(_data.units.begin(), _data.units.end(), [](const auto& lval, const auto& rval) {return lval.endurance > rval.endurance; });
-	auto unit_to_delete_it = std::find_if(_data.units.begin(), _data.units.end(), [](const auto& unit) {return unit.endurance <= 0; });
-	std::for_each(unit_to_delete_it, _data.units.end(), [this](auto&& unit_dead){ _data.unit_dead.emplace_back(unit_dead); });
+	//the living units keep their order, the dead ones are journaled and moved in id order
+	auto unit_to_delete_it = std::stable_partition(_data.units.begin(), _data.units.end(), [](const auto& unit) {return unit.endurance > 0; });
+	std::sort(unit_to_delete_it, _data.units.end(), [](const auto& lval, const auto& rval) {return lval.id < rval.id; });
+	RESOLVER_STATS_ADD(CASUALTIES, std::uint64_t(_data.units.end() - unit_to_delete_it));
+	std::for_each(unit_to_delete_it, _data.units.end(), [this](auto&& unit_dead)
+	{
+		_journal.death(unit_dead.id);
+		_data.unit_dead.emplace_back(unit_dead);
+	});
 	_data.units.erase(unit_to_delete_it, _data.units.end());
+	_order_queue_dirty = true;
 }
 
 boost::container::static_vector<coordinate, 6> game_resolver::neighbors(const coordinate& coord) const
 {
 	boost::container::static_vector<coordinate, 6> result{
-		coordinate{ coord.x + 1	, coord.y - 1, coord.z },
-			coordinate{ coord.x + 1	, coord.y	, coord.z - 1 },
-			coordinate{ coord.x		, coord.y + 1, coord.z - 1 },
-			coordinate{ coord.x - 1	, coord.y + 1, coord.z },
-			coordinate{ coord.x - 1	, coord.y	, coord.z + 1 },
-			coordinate{ coord.x		, coord.y + 1, coord.z - 1 }
+		coordinate{ coord.x + 1	, coord.y - 1 },
+			coordinate{ coord.x + 1	, coord.y },
+			coordinate{ coord.x		, coord.y + 1 },
+			coordinate{ coord.x - 1	, coord.y + 1 },
+			coordinate{ coord.x - 1	, coord.y },
+			coordinate{ coord.x		, coord.y + 1 }
 	};
 
 	auto to_erase = std::remove_if(result.begin(), result.end(), [this](const auto& coord)
 	{
-		return std::max({ std::abs(coord.x), std::abs(coord.y), std::abs(coord.z) }) > _data.current_map.diameter
+		return std::max({ std::abs(coord.x), std::abs(coord.y), std::abs(coord.z()) }) > _data.current_map.diameter
 			|| get_terrain(coord).infrastructure == 0.f;
 	});
 	result.erase(to_erase, result.end());
@@ -349,8 +805,18 @@ boost::container::static_vector<coordinate, 6> game_resolver::neighbors(const co
 
 std::pair<float, std::vector<coordinate>> game_resolver::find_path_linear(const unit& uni, const coordinate& target) const
 {
-	boost::container::flat_map<coordinate, pair_float_coordinate> visited;
-	std::priority_queue<std::pair<float, coordinate>, std::vector<std::pair<float, coordinate>>, pair_float_coord_compare> opened;
+	std::pair<float, std::vector<coordinate>> result;
+	result.first = 0.f;
+	find_path_linear(uni, target, result.first, result.second);
+	return result;
+}
+
+bool game_resolver::find_path_linear(const unit& uni, const coordinate& target, float& cost, std::vector<coordinate>& path) const
+{
+	turn_arena::scope temporaries;
+	arena_flat_map<coordinate, pair_float_coordinate> visited;
+	std::priority_queue<std::pair<float, coordinate>, arena_vector<std::pair<float, coordinate>>, pair_float_coord_compare> opened;
+	const auto& owner = get_player(uni);
 
 	opened.push(std::make_pair(0.f, uni.pos));
 	visited[uni.pos] = { 0.f, {} };
@@ -358,10 +824,11 @@ std::pair<float, std::vector<coordinate>> game_resolver::find_path_linear(const
 
 	while (opened.size() && !found)
 	{
+		RESOLVER_STATS_COUNT(PATH_EXPANSIONS);
 		for (auto& neighbor : neighbors(opened.top().second))
 		{
 			float neighbor_total_cost = opened.top().first
-				+ get_movement_cost(neighbor, get_player(uni.owner))
+				+ get_movement_cost(neighbor, owner)
 				+ static_cast<float>(distance(neighbor, target)) / 2
 				;
 
@@ -379,27 +846,26 @@ std::pair<float, std::vector<coordinate>> game_resolver::find_path_linear(const
 		opened.pop();
 	}
 
-	std::pair<float, std::vector<coordinate>> result;
+	path.clear();
 	if (found)
 	{
-		result.second = construct_path(visited, target);
-		result.first = get_movement_cost(result.second);
+		construct_path(visited, target, path);
+		cost = get_movement_cost(path.data(), path.size());
 	}
-	return result;
+	return found;
 }
 
 std::uint32_t game_resolver::distance(const coordinate& origin, const coordinate& target) const
 {
-	return std::max({ std::abs(origin.x - target.x), std::abs(origin.y - target.y), std::abs(origin.z - target.z) });
+	return std::max({ std::abs(origin.x - target.x), std::abs(origin.y - target.y), std::abs(origin.z() - target.z()) });
 }
 
 float game_resolver::get_movement_cost(const coordinate& coord, const player& pla) const
 {
 	auto base_cost = get_movement_cost(coord);
-	auto units = get_units(coord);
-	if (std::any_of(units.begin(), units.end(), [&pla, this](const auto& unit)
+	if (any_unit(coord, [&pla, this](const unit& unit)
 	{
-		return get_player(unit.get().owner).team != pla.team;
+		return get_player(unit).team != pla.team;
 	}))
 	{
 		base_cost += std::numeric_limits<float>::max() / 3.f;
@@ -421,11 +887,16 @@ float game_resolver::get_movement_cost(const order& ord) const
 }
 
 float game_resolver::get_movement_cost(const std::vector<coordinate>& coords) const
+{
+	return get_movement_cost(coords.data(), coords.size());
+}
+
+float game_resolver::get_movement_cost(const coordinate* coords, std::size_t size) const
 {
 	float result = 0.f;
-	for (const auto& coord : coords)
+	for (std::size_t i = 0; i < size; ++i)
 	{
-		result += get_movement_cost(coord);
+		result += get_movement_cost(coords[i]);
 	}
 	return result;
 }
@@ -433,20 +904,19 @@ float game_resolver::get_movement_cost(const std::vector<coordinate>& coords) co
 
 const terrain& game_resolver::get_terrain(const coordinate& coord) const
 {
-	auto find_it = std::find_if(_data.current_map.grid.cbegin(), _data.current_map.grid.cend(), [&coord](const auto& pair)
-	{
-		return pair.first == coord;
-	});
-	if (find_it != _data.current_map.grid.cend())
-	{
-		return get_terrain(find_it->second);
-	}
-	return bad_terrain_value;
+	RESOLVER_STATS_COUNT(TERRAIN_LOOKUPS);
+	return terrain_at(_data.current_map.terrain_index(coord));
+}
+
+const terrain& game_resolver::terrain_at(std::uint32_t index) const
+{
+	//dangling references were reported by link_references
+	return index < _data.terrains.size() ? _data.terrains[index] : bad_terrain_value;
 }
 
 const terrain& game_resolver::get_terrain(const reference& ref) const
 {
-	assert(ref.type == reference::DTI);
+	assert(ref.type() == reference::DTI);
 	auto find_it = std::find_if(_data.terrains.cbegin(), _data.terrains.cend(),
 		[&ref](const auto& terrain)
 	{
@@ -457,34 +927,47 @@ const terrain& game_resolver::get_terrain(const reference& ref) const
 	{
 		return *find_it;
 	}
-	std::cerr << "WARNING : failing to find terrain " << ref << std::endl;
+	diagnostics::global().report(diagnostics::TERRAIN_MISSING, ref);
 	return bad_terrain_value;
 }
 
 std::vector<coordinate> game_resolver::line(const coordinate& origin, const coordinate& target) const
 {
+	std::vector<coordinate> result(distance(origin, target));
+	line(origin, target, result.data(), result.size());
+	return result;
+}
+
+std::size_t game_resolver::line(const coordinate& origin, const coordinate& target, coordinate* out, std::size_t capacity) const
+{
+	//tiles crossed from origin (excluded) to target (included), cube coordinates interpolation
 	auto size = distance(origin, target);
-	std::vector<coordinate> result;
-	result.reserve(size);
 
-	for (std::uint32_t i = 0; i < size; i++)
+	for (std::uint32_t i = 1; i <= size && i <= capacity; i++)
 	{
-		double offset = 1.0 / (size * i);
-		result.emplace_back(
-			coordinate{
-				static_cast<std::int32_t>(std::round(static_cast<double>(origin.x + (target.x - origin.x)) * offset)),
-				static_cast<std::int32_t>(std::round(static_cast<double>(origin.y + (target.y - origin.y)) * offset)),
-				static_cast<std::int32_t>(std::round(static_cast<double>(origin.z + (target.z - origin.z)) * offset))
-		}
-		);
+		double t = static_cast<double>(i) / size;
+		double x = origin.x + (target.x - origin.x) * t;
+		double y = origin.y + (target.y - origin.y) * t;
+		double z = origin.z() + (target.z() - origin.z()) * t;
+		double rx = std::round(x), ry = std::round(y), rz = std::round(z);
+		double dx = std::abs(rx - x), dy = std::abs(ry - y), dz = std::abs(rz - z);
+		if (dx > dy && dx > dz)
+			rx = -ry - rz;
+		else if (dy > dz)
+			ry = -rx - rz;
+		else
+			rz = -rx - ry;
+
+		out[i - 1] = coordinate{ static_cast<std::int32_t>(rx), static_cast<std::int32_t>(ry), static_cast<std::int32_t>(rz) };
 	}
-	return result;
+	return size;
 }
 
 
 const unit_definition& game_resolver::get_unit_def(const reference& ref) const
 {
-	assert(ref.type == reference::DUN);
+	RESOLVER_STATS_COUNT(DEFINITION_LOOKUPS);
+	assert(ref.type() == reference::DUN);
 	auto find_it = std::find_if(_data.unit_defs.begin(), _data.unit_defs.end(),
 		[&ref](const auto& def)
 	{
@@ -496,29 +979,39 @@ const unit_definition& game_resolver::get_unit_def(const reference& ref) const
 		return *find_it;
 	}
 
-	std::cerr << "WARNING : bad unit def - ref " << ref << std::endl;
+	diagnostics::global().report(diagnostics::UNIT_DEF_MISSING, ref);
 	return bad_unit_def_value;
 }
 
-std::vector<coordinate> game_resolver::construct_path(const boost::container::flat_map<coordinate, pair_float_coordinate>& directions, const coordinate& target)
+const unit_definition& game_resolver::get_unit_def(const unit& uni) const
+{
+	RESOLVER_STATS_COUNT(DEFINITION_LOOKUPS);
+	return uni.type_index < _data.unit_defs.size() ? _data.unit_defs[uni.type_index] : bad_unit_def_value;
+}
+
+std::vector<coordinate> game_resolver::construct_path(const arena_flat_map<coordinate, pair_float_coordinate>& directions, const coordinate& target)
 {
 	std::vector<coordinate> result;
 	result.reserve(6);
+	construct_path(directions, target, result);
+	return result;
+}
 
+void game_resolver::construct_path(const arena_flat_map<coordinate, pair_float_coordinate>& directions, const coordinate& target, std::vector<coordinate>& path)
+{
 	auto end = directions.end();
 	auto start_pos = directions.find(target);
 	while (start_pos != end)
 	{
-		result.push_back(start_pos->first);
+		path.push_back(start_pos->first);
 		start_pos = directions.find(start_pos->second.coordinate_from);
 	}
-
-	return result;
 }
 
 unit& game_resolver::get_unit(const reference& ref)
 {
-	assert(ref.type == reference::UNI);
+	RESOLVER_STATS_COUNT(UNIT_LOOKUPS);
+	assert(ref.type() == reference::UNI);
 
 	auto it = std::find_if(_data.units.begin(), _data.units.end(),
 		[&ref](const auto& unit) {
@@ -527,12 +1020,13 @@ unit& game_resolver::get_unit(const reference& ref)
 	if (it != _data.units.end())
 		return *it;
 
-	std::cerr << "WARNING : bad unit ref - " << ref << std::endl;
+	diagnostics::global().report(diagnostics::UNIT_MISSING, ref);
 	return bad_unit_value;
 }
 
 std::vector<std::reference_wrapper<unit>> game_resolver::get_units(const coordinate& ref)
 {
+	RESOLVER_STATS_COUNT(UNIT_LOOKUPS);
 	std::vector<std::reference_wrapper<unit>> result;
 
 	for (auto& unit : _data.units)
@@ -548,6 +1042,7 @@ std::vector<std::reference_wrapper<unit>> game_resolver::get_units(const coordin
 
 std::vector<std::reference_wrapper<const unit>> game_resolver::get_units(const coordinate& ref) const
 {
+	RESOLVER_STATS_COUNT(UNIT_LOOKUPS);
 	std::vector<std::reference_wrapper<const unit>> result;
 
 	for (auto& unit : _data.units)
@@ -563,39 +1058,57 @@ std::vector<std::reference_wrapper<const unit>> game_resolver::get_units(const c
 
 bool game_resolver::has_unit(const coordinate & coord) const
 {
-	return std::any_of(_data.units.begin(), _data.units.end(), [&coord](const auto& unit)
-	{
-		return unit.pos == coord;
-	});
+	return any_unit(coord, [](const unit&) { return true; });
 }
 
 
 const unit_action& game_resolver::get_attack(const reference& ref) const
 {
-	assert(ref.type == reference::ATT);
+	RESOLVER_STATS_COUNT(DEFINITION_LOOKUPS);
+	assert(ref.type() == reference::ATT);
 
 	auto it = std::find_if(_data.attack_action.begin(), _data.attack_action.end(), [&ref](const auto& val) {return ref == val.id; });
 	if (it != _data.attack_action.end())
 		return *it;
 
-	std::cerr << "WARNING : No attack with ref " << ref << std::endl;
+	diagnostics::global().report(diagnostics::ATTACK_MISSING, ref);
 	return bad_unit_action;
 }
 
 const unit_action& game_resolver::get_defense(const reference& ref) const
 {
-	assert(ref.type == reference::DEF);
+	RESOLVER_STATS_COUNT(DEFINITION_LOOKUPS);
+	assert(ref.type() == reference::DEF);
 
 	auto it = std::find_if(_data.defense_action.begin(), _data.defense_action.end(), [&ref](const auto& val) {return ref == val.id; });
 	if (it != _data.defense_action.end())
 		return *it;
-	std::cerr << "WARNING : No defense with ref " << ref << std::endl;
+	diagnostics::global().report(diagnostics::DEFENSE_MISSING, ref);
 	return bad_unit_action;
 }
 
+const unit_action& game_resolver::attack_at(std::uint32_t index) const
+{
+	RESOLVER_STATS_COUNT(DEFINITION_LOOKUPS);
+	return index < _data.attack_action.size() ? _data.attack_action[index] : bad_unit_action;
+}
+
+const unit_action& game_resolver::defense_at(std::uint32_t index) const
+{
+	RESOLVER_STATS_COUNT(DEFINITION_LOOKUPS);
+	return index < _data.defense_action.size() ? _data.defense_action[index] : bad_unit_action;
+}
+
+const player& game_resolver::get_player(const unit& uni) const
+{
+	RESOLVER_STATS_COUNT(DEFINITION_LOOKUPS);
+	return uni.owner_index < _data.players.size() ? _data.players[uni.owner_index] : bad_player;
+}
+
 const player & game_resolver::get_player(const reference & ref) const
 {
-	assert(ref.type == reference::PLY);
+	RESOLVER_STATS_COUNT(DEFINITION_LOOKUPS);
+	assert(ref.type() == reference::PLY);
 
 	auto it = std::find_if(_data.players.begin(), _data.players.end(), [&ref](const auto& pla)
 	{
@@ -605,6 +1118,6 @@ const player & game_resolver::get_player(const reference & ref) const
 	{
 		return *it;
 	}
-	std::cerr << "WARNING : bad player ref " << ref << std::endl;
+	diagnostics::global().report(diagnostics::PLAYER_MISSING, ref);
 	return bad_player;
 }
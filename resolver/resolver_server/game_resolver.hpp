@@ -2,11 +2,29 @@
 #define GAME_RESOLVER_HPP
 
 #include <array>
+#include <algorithm>
 #include "data.hpp"
+#include "data_link.hpp"
+#include "turn_arena.hpp"
+#include "resolver_stats.hpp"
+#include "turn_journal.hpp"
+#include "radix_sort.hpp"
+#include "damage_table.hpp"
 #include "boost/container/flat_map.hpp"
 #include "boost/container/static_vector.hpp"
 #include "boost/optional.hpp"
 
+struct resolver_options
+{
+	//keep _data.units sorted on the Morton key of their position between the phases,
+	//units of a tile are contiguous and neighbor tiles close in memory. the resolution never
+	//depends on the order of _data.units, every tie is broken on the unit id
+	bool morton_order = false;
+	//execute_orders runs the orders phase by phase : every MOVE, then every FIRE, then BUILD and NONE
+	//each phase runs in rounds of one order per unit, the orders left behind wait for the next turn
+	bool batched_orders = false;
+};
+
 class game_resolver
 {
 public:
@@ -18,22 +36,51 @@ public:
 		FATAL_ERROR = 4
 	};
 
-	game_resolver(const game_data& game);
+	//the references of game are linked first, REF_MISSING is set in status() if some are dangling
+	//with resolve_now false, the caller runs resolve() or its phases itself
+	//the const reference form copies game, the whole world with every order and string
+	game_resolver(const game_data& game, bool resolve_now = true, const resolver_options& options = resolver_options());
+	game_resolver(game_data&& game, bool resolve_now = true, const resolver_options& options = resolver_options());
 
 	const game_data& data() const;
+	//leave the resolver empty, to call once resolve() is done
 	game_data&& get();
 
 	int status() const;
 
+	//filled by resolve(), stays empty when the RESOLVER_STATS option is off
+	const resolver_stats& stats() const;
+
+	//moves, shots, damages, retreats, deaths and rejected orders of resolve()
+	const turn_journal& journal() const;
+
+	//the unit with the most action points able to pay its next order, the lowest id on equal points
+	//the units are sorted on the first call of a phase, the next calls only move the unit that executed an order
 	boost::optional<unit&> find_first_valid_order();
+	//the unit has an order it can pay for and none of its orders were rejected
+	bool can_execute_order(const unit& unit) const;
 
 	float action_cost(const order & acc) const;
 
 	float get_attack_cost(const order & acc) const;
 
+	//fill unit_order() with the unit indices by decreasing remaining action points
+	//the units don't move, equal action points are ordered on the unit id
 	void sort_unit_per_point();
+	const std::vector<std::uint32_t>& unit_order() const;
 
+	//every temporary of the resolution is taken from turn_arena::local(), the arenas of every
+	//task_scheduler thread are released before returning
+	//phases in order : initialize_action_points, execute_orders, bring_out_the_dead, close_combat_action, bring_out_the_dead
 	void resolve();
+	void initialize_action_points();
+	//stable sort of the units on morton_key(pos)
+	void sort_units_spatially();
+	void execute_orders();
+	//phases of the batched_orders mode, return false once no unit has an order to run in the phase
+	bool execute_move_batch();
+	bool execute_fire_batch();
+	bool execute_other_batch();
 	int execute_order(unit& source, const order& order);
 	int execute_none(unit& source, const order& order);
 	int execute_move(unit& source, const order& order);
@@ -42,11 +89,6 @@ public:
 
 	int close_combat_action();
 	void bring_out_the_dead();
-private:
-	std::vector<order> _order_rejected;
-	std::vector<unit> _dead_units;
-	game_data _data;
-	int _status = 0;
 
 	struct pair_float_coordinate 
 	{ 
@@ -54,109 +96,192 @@ private:
 		coordinate coordinate_from; 
 	};
 
-	struct pair_float_coord_compare
-	{
-		template <typename T>
-		bool operator()(const T& lval, const T& rval)
-		{
-			return lval.first > rval.first;
-		}
-	};
-	
-	bool attack_in_range(const unit_action & attack_def, uint32_t distance) const;
-
-	int try_attack(unit & source, const order ord);
-	int try_attack(unit& attacker_unit, const coordinate& target, bool friendly_fire = true);
-	int try_attack(unit & attacker_unit, const coordinate & target, const unit_action& attack_def, bool friendly_fire = true);
+	// queries on the game state, they may be called outside of resolve()
+	// the vector returning forms allocate their result on the heap, their temporaries come from
+	// turn_arena::local() and are given back on return. the visitor and output buffer forms don't allocate
 
-	static const std::array<int (game_resolver::*)(unit& source, const order& order), order::SIZE> order_state_machine;
-	static const terrain bad_terrain_value;
-	static const coordinate bad_coordinate_value;
-	static const unit_definition bad_unit_def_value;
-	static const unit_action bad_unit_action;
-	static const player bad_player;
+	boost::container::static_vector<coordinate, 6> neighbors(const coordinate& coord) const;
+	std::uint32_t distance(const coordinate& origin, const coordinate& target) const;
 
-	static unit bad_unit_value;
+	std::vector<coordinate> line(const coordinate& origin, const coordinate& target) const;
+	//write at most capacity coordinates in out, return the amount of coordinates of the full line
+	std::size_t line(const coordinate& origin, const coordinate& target, coordinate* out, std::size_t capacity) const;
 
 	std::pair<float, std::vector<coordinate>> find_path_linear(const unit& pos, const coordinate& destination) const;
+	//path is cleared and filled from destination to origin, return false if no path was found
+	bool find_path_linear(const unit& uni, const coordinate& destination, float& cost, std::vector<coordinate>& path) const;
 
-	static std::vector<coordinate> construct_path(const boost::container::flat_map<coordinate, pair_float_coordinate>& directions, const coordinate& target);
-	template<typename T>
-	coordinate flood_search_first(const coordinate& pos, const T& func, std::size_t distance_max = 0) const
+	static std::vector<coordinate> construct_path(const arena_flat_map<coordinate, pair_float_coordinate>& directions, const coordinate& target);
+	static void construct_path(const arena_flat_map<coordinate, pair_float_coordinate>& directions, const coordinate& target, std::vector<coordinate>& path);
+
+	//breadth first search from pos, visitor is called on every tile matching func
+	//visitor returns false to stop the search, distance_max 0 means no limit
+	template<typename T, typename V>
+	void flood_search_visit(const coordinate& pos, const T& func, const V& visitor, std::size_t distance_max = 0) const
 	{
-		std::set<coordinate> visited;
-		std::deque<coordinate> opened;
-		opened.push_back(pos);
+		turn_arena::scope temporaries;
+		arena_set<coordinate> visited;
+		arena_deque<std::pair<coordinate, std::size_t>> opened;
+		opened.emplace_back(pos, 0);
 		visited.insert(pos);
-		std::size_t i = 1;
 
-		while (opened.size() && i != distance_max)
+		while (opened.size())
 		{
-			for (auto& neighbor : neighbors(opened.front()))
-			{
-				if (func(neighbor))
-					return neighbor;
+			auto current = opened.front();
+			opened.pop_front();
+			if (distance_max && current.second >= distance_max)
+				continue;
 
-				if (visited.find(neighbor) != visited.end())
+			for (auto& neighbor : neighbors(current.first))
+			{
+				if (visited.insert(neighbor).second)
 				{
-					opened.push_back(neighbor);
-					visited.insert(neighbor);
+					if (func(neighbor) && !visitor(neighbor))
+						return;
+					opened.emplace_back(neighbor, current.second + 1);
 				}
 			}
-			opened.pop_front();
 		}
-		return bad_coordinate_value;
+	}
+
+	template<typename T>
+	coordinate flood_search_first(const coordinate& pos, const T& func, std::size_t distance_max = 0) const
+	{
+		coordinate result = bad_coordinate_value;
+		flood_search_visit(pos, func, [&result](const coordinate& found) { result = found; return false; }, distance_max);
+		return result;
 	}
 
 	template<typename T>
 	std::vector<coordinate> flood_search_all(const coordinate& pos, const T& func, std::size_t distance_max = 0) const
 	{
-		std::set<coordinate> visited;
-		std::deque<coordinate> opened;
 		std::vector<coordinate> result;
-		opened.push_back(pos);
-		visited.insert(pos);
-		std::size_t i = 1;
-
-		while (opened.size() && i != distance_max)
-		{
-			for (auto& neighbor : neighbors(opened.front()))
-			{
-				if (visited.find(neighbor) != visited.end())
-				{
-					opened.push_back(neighbor);
-					visited.insert(neighbor);
-					if (func(neighbor))
-					{
-						result.push_back(neighbor);
-					}
-				}
-			}
-			opened.pop_front();
-		}
-
+		flood_search_visit(pos, func, [&result](const coordinate& found) { result.push_back(found); return true; }, distance_max);
 		return result;
 	}
 
-	boost::container::static_vector<coordinate, 6> neighbors(const coordinate& coord) const;
-	std::uint32_t distance(const coordinate& origin, const coordinate& target) const;
-	std::vector<coordinate> line(const coordinate& origin, const coordinate& target) const;
-
 	float get_movement_cost(const coordinate& coord, const player& pla) const;
 	float get_movement_cost(const coordinate& coord) const;
 	float get_movement_cost(const order & ord) const;
 	float get_movement_cost(const std::vector<coordinate>& coords) const;
+	float get_movement_cost(const coordinate* coords, std::size_t size) const;
 	const terrain& get_terrain(const coordinate& coord) const;
 	const terrain& get_terrain(const reference& ref) const;
 	const unit_definition& get_unit_def(const reference& ref) const;
 	const unit_action& get_attack(const reference& ref) const;
 	const unit_action& get_defense(const reference& ref) const;
 	const player& get_player(const reference& ref) const;
-	unit& get_unit(const reference& ref);
+
+	//constant time forms on the indices stored by link_references
+	const unit_definition& get_unit_def(const unit& uni) const;
+	const player& get_player(const unit& uni) const;
+	const terrain& terrain_at(std::uint32_t index) const;
+	const unit_action& attack_at(std::uint32_t index) const;
+	const unit_action& defense_at(std::uint32_t index) const;
+
 	std::vector<std::reference_wrapper<unit>> get_units(const coordinate& ref);
 	std::vector<std::reference_wrapper<const unit>> get_units(const coordinate& ref) const;
+
+	//call func on every unit standing on coord
+	template<typename F>
+	void for_each_unit(const coordinate& coord, F&& func)
+	{
+		RESOLVER_STATS_COUNT(UNIT_LOOKUPS);
+		for (auto& unit : _data.units)
+		{
+			if (unit.pos == coord)
+				func(unit);
+		}
+	}
+
+	template<typename F>
+	void for_each_unit(const coordinate& coord, F&& func) const
+	{
+		RESOLVER_STATS_COUNT(UNIT_LOOKUPS);
+		for (const auto& unit : _data.units)
+		{
+			if (unit.pos == coord)
+				func(unit);
+		}
+	}
+
+	//true if pred is true for one of the units standing on coord
+	template<typename P>
+	bool any_unit(const coordinate& coord, P&& pred) const
+	{
+		RESOLVER_STATS_COUNT(UNIT_LOOKUPS);
+		return std::any_of(_data.units.begin(), _data.units.end(), [&coord, &pred](const unit& unit)
+		{
+			return unit.pos == coord && pred(unit);
+		});
+	}
+
 	bool has_unit(const coordinate& coord) const;
-	unit_action calculate_unit_defense(const unit_definition& unit_def) const;
+
+private:
+	std::vector<order> _order_rejected;
+	std::vector<unit> _dead_units;
+	game_data _data;
+	resolver_options _options;
+	int _status = 0;
+	resolver_stats _stats;
+	turn_journal _journal;
+	radix_sorter _sorter;
+	damage_table _damage;
+	std::vector<float> _action_points;
+	std::vector<std::uint32_t> _unit_order;
+	std::vector<std::uint32_t> _unit_ids; //reference::packed() of every unit, see sort_unit_per_point
+
+	struct queued_order
+	{
+		float action_points = 0; //of the unit when it was queued
+		std::uint32_t index = 0;
+	};
+	std::vector<queued_order> _order_queue; //heap of the units of find_first_valid_order
+	bool _order_queue_dirty = true; //set when the units or their action points are reset
+
+	struct pair_float_coord_compare
+	{
+		template <typename T>
+		bool operator()(const T& lval, const T& rval)
+		{
+			return lval.first > rval.first;
+		}
+	};
+	
+	bool attack_in_range(const unit_action & attack_def, uint32_t distance) const;
+
+	//most damaging attack of attacker_unit against first_target that it can afford at distance dis, NO_INDEX if none
+	//first_target null : the first such attack in declaration order
+	std::uint32_t select_attack(const unit& attacker_unit, std::uint32_t dis, const unit* first_target, std::uint32_t terrain_index) const;
+	std::uint32_t attack_damage(std::uint32_t attack_index, std::int32_t attacker_endurance, const unit& target, std::uint32_t terrain_index) const;
+	static void pay_attack(unit& attacker_unit, const unit_action& att);
+
+	//close combat of the size units of a contested tile, reading endurance and adding to damage,
+	//attack receives the attack used by every unit. apply_fight journals the fight and applies damage
+	void fight(std::reference_wrapper<unit>* units, std::size_t size, const std::int32_t* endurance, std::int32_t* damage, std::uint32_t* attack);
+	void apply_fight(std::reference_wrapper<unit>* units, std::size_t size, const std::int32_t* endurance, const std::int32_t* damage, const std::uint32_t* attack);
+
+	//indices of the units able to pay for their front order, when its type is in type_mask (bit 1 << order::T_type)
+	void collect_batch(std::uint32_t type_mask, arena_vector<std::uint32_t>& batch) const;
+	//pop the front order of source, or reject it and the following ones when result isn't NONE
+	void finish_order(unit& source, int result);
+
+	int try_attack(unit & source, const order ord);
+	int try_attack(unit& attacker_unit, const coordinate& target, bool friendly_fire = true);
+	//damages every unit on target with the attack at attack_index of game_data::attack_action
+	int try_attack(unit & attacker_unit, const coordinate & target, std::uint32_t attack_index, bool friendly_fire = true);
+
+	static const std::array<int (game_resolver::*)(unit& source, const order& order), order::SIZE> order_state_machine;
+	static const terrain bad_terrain_value;
+	static const coordinate bad_coordinate_value;
+	static const unit_definition bad_unit_def_value;
+	static const unit_action bad_unit_action;
+	static const player bad_player;
+
+	static unit bad_unit_value;
+
+	unit& get_unit(const reference& ref);
 };
 
 #endif //!GAME_RESOLVER_HPP
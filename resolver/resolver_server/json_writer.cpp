@@ -0,0 +1,295 @@
+#include "json_writer.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+   const char digit_pairs[201] =
+      "00010203040506070809"
+      "10111213141516171819"
+      "20212223242526272829"
+      "30313233343536373839"
+      "40414243444546474849"
+      "50515253545556575859"
+      "60616263646566676869"
+      "70717273747576777879"
+      "80818283848586878889"
+      "90919293949596979899";
+
+   //write num backward ending at end, return the first character written
+   char* format_uint(std::uint64_t num, char* end)
+   {
+      while (num >= 100)
+      {
+         auto pair = (num % 100) * 2;
+         num /= 100;
+         *--end = digit_pairs[pair + 1];
+         *--end = digit_pairs[pair];
+      }
+      if (num >= 10)
+      {
+         *--end = digit_pairs[num * 2 + 1];
+         *--end = digit_pairs[num * 2];
+      }
+      else
+      {
+         *--end = static_cast<char>('0' + num);
+      }
+      return end;
+   }
+
+   bool need_escape(char c)
+   {
+      return c == '"' || c == '\\' || (c >= 0 && c <= 0x1F);
+   }
+}
+
+json_writer::json_writer(std::ostream& stream, std::size_t buffer_size)
+   : _stream(stream), _buffer(buffer_size < 64 ? 64 : buffer_size)
+{}
+
+json_writer::~json_writer()
+{
+   flush();
+}
+
+json_writer& json_writer::begin_object()
+{
+   open('{');
+   return *this;
+}
+
+json_writer& json_writer::end_object()
+{
+   close('}');
+   return *this;
+}
+
+json_writer& json_writer::begin_array()
+{
+   open('[');
+   return *this;
+}
+
+json_writer& json_writer::end_array()
+{
+   close(']');
+   return *this;
+}
+
+json_writer& json_writer::key(astd::string_view name)
+{
+   separator();
+   quoted(name);
+   put(':');
+   _after_key = true;
+   return *this;
+}
+
+json_writer& json_writer::key(const reference& ref)
+{
+   separator();
+   reserve(reference::SERIALIZED_SIZE + 3);
+   put('"');
+   _used += ref.serialize(_buffer.data() + _used);
+   put('"');
+   put(':');
+   _after_key = true;
+   return *this;
+}
+
+json_writer& json_writer::value(std::int64_t num)
+{
+   separator();
+   char buffer[24];
+   char* end = buffer + sizeof(buffer);
+   char* start = format_uint(num < 0 ? 0 - std::uint64_t(num) : std::uint64_t(num), end);
+   if (num < 0)
+   {
+      *--start = '-';
+   }
+   put(start, end - start);
+   return *this;
+}
+
+json_writer& json_writer::value(std::int32_t num)
+{
+   return value(std::int64_t(num));
+}
+
+json_writer& json_writer::value(std::uint32_t num)
+{
+   return value(std::int64_t(num));
+}
+
+json_writer& json_writer::value(double num)
+{
+   separator();
+   char buffer[32];
+   int size = 0;
+   //same representation as jsoncpp : 17 significant digits, no special floats
+   if (std::isfinite(num))
+   {
+      size = std::snprintf(buffer, sizeof(buffer), "%.17g", num);
+      std::replace(buffer, buffer + size, ',', '.');
+   }
+   else if (num != num)
+   {
+      size = std::snprintf(buffer, sizeof(buffer), "null");
+   }
+   else
+   {
+      size = std::snprintf(buffer, sizeof(buffer), num < 0 ? "-1e+9999" : "1e+9999");
+   }
+   put(buffer, static_cast<std::size_t>(size));
+   return *this;
+}
+
+json_writer& json_writer::value(float num)
+{
+   return value(double(num));
+}
+
+json_writer& json_writer::value(astd::string_view str)
+{
+   separator();
+   quoted(str);
+   return *this;
+}
+
+json_writer& json_writer::value(const char* str)
+{
+   return value(astd::string_view(str));
+}
+
+json_writer& json_writer::value(const reference& ref)
+{
+   separator();
+   reserve(reference::SERIALIZED_SIZE + 2);
+   put('"');
+   _used += ref.serialize(_buffer.data() + _used);
+   put('"');
+   return *this;
+}
+
+bool json_writer::flush()
+{
+   if (_used)
+   {
+      _stream.write(_buffer.data(), _used);
+      _used = 0;
+   }
+   return bool(_stream) && !_too_deep;
+}
+
+void json_writer::separator()
+{
+   if (_after_key)
+   {
+      _after_key = false;
+      return;
+   }
+   if (_depth && _depth <= MAX_DEPTH)
+   {
+      if (!_first[_depth - 1])
+      {
+         put(',');
+      }
+      _first[_depth - 1] = false;
+   }
+}
+
+void json_writer::open(char c)
+{
+   separator();
+   put(c);
+   //deeper levels aren't separated anymore, flush() reports the broken document
+   assert(_depth < MAX_DEPTH);
+   if (_depth < MAX_DEPTH)
+   {
+      _first[_depth] = true;
+   }
+   else
+   {
+      _too_deep = true;
+   }
+   ++_depth;
+}
+
+void json_writer::close(char c)
+{
+   assert(_depth > 0);
+   --_depth;
+   put(c);
+}
+
+void json_writer::put(char c)
+{
+   if (_used == _buffer.size())
+   {
+      flush();
+   }
+   _buffer[_used++] = c;
+}
+
+void json_writer::put(const char* str, std::size_t size)
+{
+   if (size > _buffer.size() - _used)
+   {
+      flush();
+      if (size > _buffer.size())
+      {
+         _stream.write(str, size);
+         return;
+      }
+   }
+   std::memcpy(_buffer.data() + _used, str, size);
+   _used += size;
+}
+
+void json_writer::reserve(std::size_t size)
+{
+   if (size > _buffer.size() - _used)
+   {
+      flush();
+   }
+}
+
+void json_writer::quoted(astd::string_view str)
+{
+   put('"');
+   const char* data = str.data();
+   std::size_t chunk_start = 0;
+   for (std::size_t i = 0; i < str.size(); ++i)
+   {
+      if (!need_escape(data[i]))
+      {
+         continue;
+      }
+
+      put(data + chunk_start, i - chunk_start);
+      chunk_start = i + 1;
+      switch (data[i])
+      {
+      case '"': put("\\\"", 2); break;
+      case '\\': put("\\\\", 2); break;
+      case '\b': put("\\b", 2); break;
+      case '\f': put("\\f", 2); break;
+      case '\n': put("\\n", 2); break;
+      case '\r': put("\\r", 2); break;
+      case '\t': put("\\t", 2); break;
+      default:
+         {
+            char escaped[7];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04X", static_cast<int>(data[i]));
+            put(escaped, 6);
+         }
+         break;
+      }
+   }
+   put(data + chunk_start, str.size() - chunk_start);
+   put('"');
+}
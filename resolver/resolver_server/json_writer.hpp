@@ -0,0 +1,67 @@
+#ifndef JSON_WRITER_HPP
+#define JSON_WRITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "astring_view.hpp"
+#include "reference.hpp"
+
+// compact json output written straight into a large buffer, no intermediate Json::Value tree
+// numbers and strings are formatted like jsoncpp does, so the output parses to the same values
+class json_writer
+{
+public:
+   enum
+   {
+      DEFAULT_BUFFER_SIZE = 1 << 20,
+      MAX_DEPTH = 32
+   };
+
+   explicit json_writer(std::ostream& stream, std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+   ~json_writer();
+
+   json_writer(const json_writer&) = delete;
+   json_writer& operator=(const json_writer&) = delete;
+
+   json_writer& begin_object();
+   json_writer& end_object();
+   json_writer& begin_array();
+   json_writer& end_array();
+
+   json_writer& key(astd::string_view name);
+   json_writer& key(const reference& ref);
+
+   json_writer& value(std::int64_t num);
+   json_writer& value(std::int32_t num);
+   json_writer& value(std::uint32_t num);
+   json_writer& value(double num);
+   json_writer& value(float num);
+   json_writer& value(astd::string_view str);
+   json_writer& value(const char* str);
+   json_writer& value(const reference& ref);
+
+   //write the buffered output to the stream, return false if the stream failed
+   //or if the document was nested deeper than MAX_DEPTH
+   bool flush();
+
+private:
+   std::ostream& _stream;
+   std::vector<char> _buffer;
+   std::size_t _used = 0;
+   std::size_t _depth = 0;
+   bool _first[MAX_DEPTH] = { true };
+   bool _after_key = false;
+   bool _too_deep = false;
+
+   void separator();
+   void open(char c);
+   void close(char c);
+   void put(char c);
+   void put(const char* str, std::size_t size);
+   void reserve(std::size_t size);
+   void quoted(astd::string_view str);
+};
+
+#endif //!JSON_WRITER_HPP
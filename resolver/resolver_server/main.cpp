@@ -7,6 +7,9 @@
 #include "data_parser.hpp"
 #include "data_dumper.hpp"
 #include "game_resolver.hpp"
+#include "trace_recorder.hpp"
+#include "diagnostics.hpp"
+#include "task_scheduler.hpp"
 #include <boost/program_options/positional_options.hpp>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
@@ -21,7 +24,16 @@ int main(int argc, char ** argv)
 	boost::program_options::options_description desc("Allowed options");
 	desc.add_options()("help", "produce this help message")
 		("o", boost::program_options::value<astd::filesystem::path>(), "<PATH> output directory")
-		("i", boost::program_options::value<astd::filesystem::path>(), "<PATH> input directory");
+		("i", boost::program_options::value<astd::filesystem::path>(), "<PATH> input directory")
+		("turn", boost::program_options::value<std::int32_t>(), "<NUM> turn of the order files to load (default : turn following the order manifest, or latest)")
+		("sync", "flush the output directory to disk before the turn manifest is written")
+		("trace", boost::program_options::value<astd::filesystem::path>(), "<PATH> record a chrome trace of the turn in PATH")
+		("morton", "keep the units sorted along a Morton curve of their position")
+		("batched", "execute the orders phase by phase : every MOVE, then every FIRE, then the others")
+		("threads", boost::program_options::value<std::uint32_t>(), "<NUM> threads of the task scheduler, 1 runs everything on the main thread (default : 0, one per core)")
+		("pin", "bind every scheduler thread to its own core")
+		("journal", boost::program_options::value<std::string>(), "<binary|json|both> write the events of the turn next to the state dump")
+		("verbosity", boost::program_options::value<std::string>(), "<quiet|summary|first|all> warnings echoed on the error output (default : first)");
 
 	boost::program_options::positional_options_description p;
 	p.add("i", -1);
@@ -42,14 +54,14 @@ int main(int argc, char ** argv)
 	catch (boost::program_options::error e)
 	{
 		std::cerr << "ERROR : " << e.what() << std::endl;
-		std::cout << "resolver_server [--help] [-o <output_path>] [-i] input_path" << std::endl;
+		std::cout << "resolver_server [--help] [-o <output_path>] [--turn <num>] [--sync] [--trace <path>] [--verbosity <level>] [--journal <format>] [--morton] [--batched] [--threads <num>] [--pin] [-i] input_path" << std::endl;
 		std::cout << desc << std::endl;
 		return 1;
 	}
 
 	if (vm.find("help") != vm.end())
 	{
-		std::cout << "resolver_server [--help] [-o <output_path>] [-i] input_path" << std::endl;
+		std::cout << "resolver_server [--help] [-o <output_path>] [--turn <num>] [--sync] [--trace <path>] [--verbosity <level>] [--journal <format>] [--morton] [--batched] [--threads <num>] [--pin] [-i] input_path" << std::endl;
 		std::cout << desc << std::endl;
 		return 0;
 	}
@@ -58,7 +70,7 @@ int main(int argc, char ** argv)
 	if (it_input == vm.end())
 	{
 		std::cerr << "ERROR : No input directory !" << std::endl;
-		std::cout << "resolver_server [--help] [-o <output_path>] [-i] input_path" << std::endl;
+		std::cout << "resolver_server [--help] [-o <output_path>] [--turn <num>] [--sync] [--trace <path>] [--verbosity <level>] [--journal <format>] [--morton] [--batched] [--threads <num>] [--pin] [-i] input_path" << std::endl;
 		std::cout << desc << std::endl;
 		return 1;
 	}
@@ -88,12 +100,111 @@ int main(int argc, char ** argv)
 		}
 	}
 
-	data_parser parser(input_path);
+	std::int32_t turn = order_file_index::NO_TURN;
+	auto it_turn = vm.find("turn");
+	if (it_turn != vm.end())
+	{
+		turn = it_turn->second.as<std::int32_t>();
+	}
+
+	auto it_verbosity = vm.find("verbosity");
+	if (it_verbosity != vm.end())
+	{
+		diagnostics::T_verbosity verbosity;
+		if (!diagnostics::parse_verbosity(it_verbosity->second.as<std::string>(), verbosity))
+		{
+			std::cerr << "ERROR : verbosity " << it_verbosity->second.as<std::string>() << " not known" << std::endl;
+			return 1;
+		}
+		diagnostics::global().set_verbosity(verbosity);
+	}
+
+	bool journal_binary = false;
+	bool journal_json = false;
+	auto it_journal = vm.find("journal");
+	if (it_journal != vm.end())
+	{
+		auto format = it_journal->second.as<std::string>();
+		journal_binary = format == "binary" || format == "both";
+		journal_json = format == "json" || format == "both";
+		if (!journal_binary && !journal_json)
+		{
+			std::cerr << "ERROR : journal format " << format << " not known" << std::endl;
+			return 1;
+		}
+	}
+
+	auto it_trace = vm.find("trace");
+	trace_recorder::enable(it_trace != vm.end());
+
+	auto it_threads = vm.find("threads");
+	task_scheduler::configure(it_threads != vm.end() ? it_threads->second.as<std::uint32_t>() : 0, vm.find("pin") != vm.end());
+
+	data_parser parser(input_path, turn);
+	if (parser.status() & data_parser::COORDINATE_OUT_OF_RANGE)
+	{
+		std::cerr << "ERROR : coordinates out of range in " << input_path << ", the turn isn't resolved" << std::endl;
+		return 1;
+	}
+
+	resolver_options options;
+	options.morton_order = vm.find("morton") != vm.end();
+	options.batched_orders = vm.find("batched") != vm.end();
+	game_resolver resolver(parser.get(), true, options);
+	int result = 0;
+	//dangling references are reported in diagnostics.json, they don't prevent the dump
+	if ((resolver.status() & game_resolver::FATAL_ERROR) == 0)
+	{
+		//the files of the turn that aren't game state are written by the dumper too, before the manifest
+		std::vector<data_dumper::extra_file> extra_files;
+#ifdef RESOLVER_STATS
+		extra_files.push_back({ resolver_stats::filename, [&](const astd::filesystem::path& path)
+		{
+			return resolver.stats().dump(path, parser.turn());
+		} });
+#endif
+		extra_files.push_back({ diagnostics::filename, [](const astd::filesystem::path& path)
+		{
+			return diagnostics::global().dump(path);
+		} });
+		if (journal_binary)
+		{
+			extra_files.push_back({ turn_journal::filename, [&](const astd::filesystem::path& path)
+			{
+				return resolver.journal().write(path, parser.turn());
+			} });
+		}
+		if (journal_json)
+		{
+			extra_files.push_back({ turn_journal::json_filename, [&](const astd::filesystem::path& path)
+			{
+				std::vector<turn_journal::event> events;
+				int status = turn_journal::decode(resolver.journal().records().data(), resolver.journal().records().size(), events);
+				return status != turn_journal::NONE ? status : turn_journal::export_json(events, parser.turn(), path);
+			} });
+		}
+
+		data_dumper dump(resolver.data(), output_path, vm.find("sync") != vm.end(), extra_files);
+		diagnostics::global().print_summary(output_path / diagnostics::filename);
+		if (dump.status() == data_dumper::NONE)
+		{
+			if (parser.commit_turn() != data_parser::NONE)
+			{
+				std::cerr << "ERROR : the order manifest couldn't be written in " << input_path << std::endl;
+				result = 1;
+			}
+		}
+		else
+		{
+			std::cerr << "ERROR : the turn couldn't be written in " << output_path << std::endl;
+			result = 1;
+		}
+	}
 
-	game_resolver resolver(parser.data());
-	if (resolver.status() == 0)
+	if (it_trace != vm.end() && trace_recorder::write(it_trace->second.as<astd::filesystem::path>()) != 0)
 	{
-		data_dumper dump(resolver.data(), output_path);
+		std::cerr << "ERROR : the trace couldn't be written in " << it_trace->second.as<astd::filesystem::path>() << std::endl;
+		result = 1;
 	}
-	return 0;
+	return result;
 }
\ No newline at end of file
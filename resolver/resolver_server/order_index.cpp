@@ -0,0 +1,163 @@
+#include "order_index.hpp"
+#include "json/json.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+const char* const order_file_index::manifest_filename = "order_manifest.json";
+
+bool order_file_index::parse_filename(const std::string& filename, entry& result)
+{
+   const astd::string_view prefix = "order_";
+   const astd::string_view extension = ".json";
+   astd::string_view name = filename;
+
+   if (name.size() <= prefix.size() + extension.size()
+      || name.substr(0, prefix.size()) != prefix
+      || name.substr(name.size() - extension.size()) != extension)
+   {
+      return false;
+   }
+
+   name = name.substr(prefix.size(), name.size() - prefix.size() - extension.size());
+   auto separator = name.rfind('_');
+   if (separator == astd::string_view::npos || separator + 1 == name.size())
+   {
+      return false;
+   }
+
+   auto player_str = name.substr(0, separator);
+   auto turn_str = name.substr(separator + 1);
+   if (player_str.size() <= reference::PREFIX_SIZE - 1
+      || player_str.substr(0, reference::PREFIX_SIZE - 1) != reference::converter_array[reference::PLY]
+      || !std::all_of(turn_str.begin(), turn_str.end(), [](char c) { return c >= '0' && c <= '9'; }))
+   {
+      return false;
+   }
+
+   result.player = reference(player_str);
+   result.turn = static_cast<std::int32_t>(xts::fast_str_to_uint(turn_str));
+   return true;
+}
+
+bool order_file_index::add(const astd::filesystem::path& path)
+{
+   entry new_entry;
+   if (!parse_filename(path.filename().generic_string(), new_entry))
+   {
+      return false;
+   }
+   new_entry.path = path;
+   _entries.emplace_back(std::move(new_entry));
+   return true;
+}
+
+int order_file_index::load_manifest(const astd::filesystem::path& directory)
+{
+   auto path = directory / manifest_filename;
+   if (!astd::filesystem::exists(path))
+   {
+      return NONE;
+   }
+
+   std::ifstream stream(path.c_str());
+   if (!stream)
+   {
+      return FILE_OPEN_FAILED;
+   }
+
+   Json::Value root;
+   Json::CharReaderBuilder rbuilder;
+   std::string errs;
+   if (!Json::parseFromStream(rbuilder, stream, &root, &errs))
+   {
+      std::cerr << "parsing " << path << " failed : " << errs << std::endl;
+      return JSON_PARSING_FAILED;
+   }
+
+   _last_consumed_turn = root["last_turn"].asInt();
+   return NONE;
+}
+
+int order_file_index::save_manifest(const astd::filesystem::path& directory, std::int32_t turn) const
+{
+   //written aside then renamed, an interrupted write never leaves a truncated manifest
+   auto final_path = directory / manifest_filename;
+   auto temp_path = directory / (std::string(manifest_filename) + ".tmp");
+   std::error_code err;
+   {
+      std::ofstream stream(temp_path.c_str(), std::ios::trunc);
+      if (!stream)
+      {
+         return FILE_OPEN_FAILED;
+      }
+
+      Json::Value root;
+      root["last_turn"] = std::max(turn, _last_consumed_turn);
+      root["files"] = Json::Value(Json::arrayValue);
+      for (const auto& path : select(turn))
+      {
+         root["files"].append(path.filename().generic_string());
+      }
+
+      stream << root;
+      stream.close();
+      if (!stream)
+      {
+         std::cerr << "ERROR : cannot write " << temp_path << std::endl;
+         astd::filesystem::remove(temp_path, err);
+         return FILE_OPEN_FAILED;
+      }
+   }
+
+   astd::filesystem::rename(temp_path, final_path, err);
+   if (err)
+   {
+      std::cerr << "ERROR : cannot rename " << temp_path << " to " << final_path << " : " << err.message() << std::endl;
+      astd::filesystem::remove(temp_path, err);
+      return FILE_OPEN_FAILED;
+   }
+   return NONE;
+}
+
+std::int32_t order_file_index::default_turn() const
+{
+   if (_last_consumed_turn != NO_TURN)
+   {
+      return _last_consumed_turn + 1;
+   }
+   return latest_turn();
+}
+
+std::int32_t order_file_index::latest_turn() const
+{
+   std::int32_t result = NO_TURN;
+   for (const auto& current : _entries)
+   {
+      result = std::max(result, current.turn);
+   }
+   return result;
+}
+
+std::int32_t order_file_index::last_consumed_turn() const
+{
+   return _last_consumed_turn;
+}
+
+std::vector<astd::filesystem::path> order_file_index::select(std::int32_t turn) const
+{
+   std::vector<astd::filesystem::path> result;
+   if (turn == NO_TURN)
+   {
+      return result;
+   }
+
+   for (const auto& current : _entries)
+   {
+      if (current.turn == turn)
+      {
+         result.push_back(current.path);
+      }
+   }
+   return result;
+}
@@ -0,0 +1,61 @@
+#ifndef ORDER_INDEX_HPP
+#define ORDER_INDEX_HPP
+
+#include "afilesystem.hpp"
+#include "reference.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// index of the order_<player>_<turn>.json files of a game directory
+// only the files of the selected turn are handed to the parser, the manifest
+// remembers the last turn consumed so that older files are never read again
+class order_file_index
+{
+public:
+   enum error_code : int
+   {
+      NONE = 0
+      , FILE_OPEN_FAILED
+      , JSON_PARSING_FAILED
+   };
+
+   enum : std::int32_t
+   {
+      NO_TURN = -1
+   };
+
+   struct entry
+   {
+      reference player;
+      std::int32_t turn = NO_TURN;
+      astd::filesystem::path path;
+   };
+
+   static const char* const manifest_filename;
+
+   //return false if the filename doesn't follow the order_<player>_<turn>.json pattern
+   static bool parse_filename(const std::string& filename, entry& result);
+
+   //return false if the file isn't an order file
+   bool add(const astd::filesystem::path& path);
+
+   int load_manifest(const astd::filesystem::path& directory);
+
+   int save_manifest(const astd::filesystem::path& directory, std::int32_t turn) const;
+
+   //turn requested when none is given : the one following the manifest, or the latest one found
+   std::int32_t default_turn() const;
+
+   std::int32_t latest_turn() const;
+
+   std::int32_t last_consumed_turn() const;
+
+   std::vector<astd::filesystem::path> select(std::int32_t turn) const;
+
+private:
+   std::vector<entry> _entries;
+   std::int32_t _last_consumed_turn = NO_TURN;
+};
+
+#endif //!ORDER_INDEX_HPP
@@ -0,0 +1,110 @@
+#include "radix_sort.hpp"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+std::uint32_t radix_sorter::ordered_bits(float key)
+{
+   std::uint32_t bits;
+   static_assert(sizeof(bits) == sizeof(key), "float must be 32 bits");
+   std::memcpy(&bits, &key, sizeof(bits));
+   return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+void radix_sorter::sort_ascending(const float* keys, std::size_t size, std::vector<std::uint32_t>& index)
+{
+   _keys.resize(size);
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      _keys[i] = ordered_bits(keys[i]);
+   }
+   sort(size, 32, index);
+}
+
+void radix_sorter::sort_descending(const float* keys, std::size_t size, std::vector<std::uint32_t>& index)
+{
+   _keys.resize(size);
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      _keys[i] = ~ordered_bits(keys[i]);
+   }
+   sort(size, 32, index);
+}
+
+void radix_sorter::sort_descending(const float* keys, const std::uint32_t* ties, std::size_t size, std::vector<std::uint32_t>& index)
+{
+   //ties already ascending : the stable sort of the keys alone keeps them
+   if (std::is_sorted(ties, ties + size))
+   {
+      sort_descending(keys, size, index);
+      return;
+   }
+
+   //the ties only take the bits that differ between them, usually fewer passes than 64 bits keys
+   auto range = std::minmax_element(ties, ties + size);
+   std::uint32_t tie_min = size ? *range.first : 0;
+   std::uint32_t tie_span = size ? *range.second - tie_min : 0;
+   unsigned tie_bits = 0;
+   while (tie_bits < 32 && (tie_span >> tie_bits))
+   {
+      ++tie_bits;
+   }
+
+   _keys.resize(size);
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      _keys[i] = std::uint64_t(~ordered_bits(keys[i])) << tie_bits | (ties[i] - tie_min);
+   }
+   sort(size, 32 + tie_bits, index);
+}
+
+void radix_sorter::sort(std::size_t size, unsigned key_bits, std::vector<std::uint32_t>& index)
+{
+   const unsigned passes = (key_bits + DIGIT_BITS - 1) / DIGIT_BITS;
+   index.resize(size);
+   std::iota(index.begin(), index.end(), 0u);
+   _scratch.resize(size);
+   _key_scratch.resize(size);
+
+   //every histogram in a single read of the keys
+   auto& histograms = _histograms;
+   for (auto& histogram : histograms)
+   {
+      histogram.fill(0);
+   }
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      for (unsigned pass = 0; pass < passes; ++pass)
+      {
+         ++histograms[pass][(_keys[i] >> (pass * DIGIT_BITS)) & (BUCKETS - 1)];
+      }
+   }
+
+   for (unsigned pass = 0; pass < passes; ++pass)
+   {
+      auto& histogram = histograms[pass];
+      auto shift = pass * DIGIT_BITS;
+      if (size == 0 || histogram[(_keys[0] >> shift) & (BUCKETS - 1)] == size)
+      {
+         continue;
+      }
+
+      std::uint32_t offset = 0;
+      for (auto& count : histogram)
+      {
+         auto current = count;
+         count = offset;
+         offset += current;
+      }
+
+      //the keys move with their index, every pass reads them in sequence
+      for (std::size_t i = 0; i < size; ++i)
+      {
+         auto slot = histogram[(_keys[i] >> shift) & (BUCKETS - 1)]++;
+         _scratch[slot] = index[i];
+         _key_scratch[slot] = _keys[i];
+      }
+      index.swap(_scratch);
+      _keys.swap(_key_scratch);
+   }
+}
@@ -0,0 +1,41 @@
+#ifndef RADIX_SORT_HPP
+#define RADIX_SORT_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// stable LSD radix sort of an index array on float keys, the keyed objects never move
+// floats are mapped to unsigned integers keeping their order : sign bit flipped for the
+// positives, every bit flipped for the negatives. three passes of 11 bits, up to six with
+// a tie key in the low bits, a pass is skipped when every key has the same digit
+class radix_sorter
+{
+public:
+   enum
+   {
+      DIGIT_BITS = 11,
+      BUCKETS = 1 << DIGIT_BITS,
+      PASSES = (64 + DIGIT_BITS - 1) / DIGIT_BITS
+   };
+
+   //index is filled with 0 .. size - 1 ordered on keys, equal keys keep their index order
+   void sort_ascending(const float* keys, std::size_t size, std::vector<std::uint32_t>& index);
+   void sort_descending(const float* keys, std::size_t size, std::vector<std::uint32_t>& index);
+   //equal keys are ordered on ties ascending instead of their index
+   void sort_descending(const float* keys, const std::uint32_t* ties, std::size_t size, std::vector<std::uint32_t>& index);
+
+   static std::uint32_t ordered_bits(float key);
+
+private:
+   std::vector<std::uint64_t> _keys;
+   std::vector<std::uint32_t> _scratch;
+   std::vector<std::uint64_t> _key_scratch;
+   std::array<std::array<std::uint32_t, BUCKETS>, PASSES> _histograms;
+
+   //sort on the key_bits low bits of _keys
+   void sort(std::size_t size, unsigned key_bits, std::vector<std::uint32_t>& index);
+};
+
+#endif //!RADIX_SORT_HPP
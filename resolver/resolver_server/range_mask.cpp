@@ -0,0 +1,74 @@
+#include "range_mask.hpp"
+
+namespace
+{
+   bool parse_distance(astd::string_view str, std::uint32_t& result)
+   {
+      if (str.empty() || str.size() > 2)
+         return false;
+      result = 0;
+      for (char c : str)
+      {
+         if (c < '0' || c > '9')
+            return false;
+         result = result * 10 + static_cast<std::uint32_t>(c - '0');
+      }
+      return result <= RANGE_MAX_DISTANCE;
+   }
+}
+
+bool parse_range(astd::string_view str, range_mask& result)
+{
+   range_mask parsed = 0;
+   result = 0;
+   while (true)
+   {
+      auto separator = str.find(':');
+      auto token = str.substr(0, separator);
+      auto dash = token.find('-');
+      std::uint32_t min = 0, max = 0;
+      if (dash == astd::string_view::npos)
+      {
+         if (!parse_distance(token, min))
+            return false;
+         max = min;
+      }
+      else if (!parse_distance(token.substr(0, dash), min)
+         || !parse_distance(token.substr(dash + 1), max)
+         || min > max)
+      {
+         return false;
+      }
+      parsed |= range_between(min, max);
+
+      if (separator == astd::string_view::npos)
+      {
+         result = parsed;
+         return true;
+      }
+      str = str.substr(separator + 1);
+   }
+}
+
+std::string serialize_range(range_mask mask)
+{
+   std::string result;
+   while (mask)
+   {
+      auto min = range_lowest(mask);
+      auto max = min;
+      while (max < RANGE_MAX_DISTANCE && range_contains(mask, max + 1))
+         ++max;
+      mask &= ~range_between(min, max);
+
+      if (!result.empty())
+         result += ':';
+      result += std::to_string(min);
+      if (max != min)
+      {
+         result += '-';
+         result += std::to_string(max);
+      }
+   }
+   return result;
+}
@@ -0,0 +1,102 @@
+#ifndef RANGE_MASK_HPP
+#define RANGE_MASK_HPP
+
+#include <cstdint>
+#include <string>
+#include "astring_view.hpp"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// set of the distances an attack can fire at, bit d is set if the attack reaches distance d
+// written as "X", "X-Y" or a ':' separated list of those, see data/proxima/README.md
+typedef std::uint64_t range_mask;
+
+enum : std::uint32_t
+{
+   RANGE_MAX_DISTANCE = 63
+};
+
+inline bool range_contains(range_mask mask, std::uint32_t distance)
+{
+   return distance <= RANGE_MAX_DISTANCE && (mask >> distance) & 1u;
+}
+
+//mask of the distances from min to max included, empty if min > max
+inline range_mask range_between(std::uint32_t min, std::uint32_t max)
+{
+   if (min > max || min > RANGE_MAX_DISTANCE)
+      return 0;
+   if (max > RANGE_MAX_DISTANCE)
+      max = RANGE_MAX_DISTANCE;
+   range_mask upto_max = max == RANGE_MAX_DISTANCE ? ~range_mask(0) : (range_mask(1) << (max + 1)) - 1;
+   return upto_max & ~((range_mask(1) << min) - 1);
+}
+
+//0 for an empty mask, a single instruction on msvc, gcc and clang
+inline std::uint32_t range_lowest(range_mask mask)
+{
+   if (!mask)
+      return 0;
+#if defined(_MSC_VER) && defined(_M_X64)
+   unsigned long result;
+   _BitScanForward64(&result, mask);
+   return static_cast<std::uint32_t>(result);
+#elif defined(__GNUC__)
+   return static_cast<std::uint32_t>(__builtin_ctzll(mask));
+#else
+   //de Bruijn sequence : the lowest bit alone selects a distinct slot of the table
+   static const std::uint8_t positions[64] =
+   {
+      0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+      62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+      63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+      46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+   };
+   return positions[((mask & (0 - mask)) * 0x03F79D71B4CB0A89ull) >> 58];
+#endif
+}
+
+inline std::uint32_t range_highest(range_mask mask)
+{
+   if (!mask)
+      return 0;
+#if defined(_MSC_VER) && defined(_M_X64)
+   unsigned long result;
+   _BitScanReverse64(&result, mask);
+   return static_cast<std::uint32_t>(result);
+#elif defined(__GNUC__)
+   return static_cast<std::uint32_t>(RANGE_MAX_DISTANCE - __builtin_clzll(mask));
+#else
+   std::uint32_t result = RANGE_MAX_DISTANCE;
+   while (!(mask >> result))
+      --result;
+   return result;
+#endif
+}
+
+inline std::uint32_t range_count(range_mask mask)
+{
+   std::uint32_t result = 0;
+   for (; mask; mask &= mask - 1)
+      ++result;
+   return result;
+}
+
+//call func(distance) on every distance of mask, in increasing order
+template<typename F>
+void range_for_each(range_mask mask, F&& func)
+{
+   for (; mask; mask &= mask - 1)
+   {
+      func(range_lowest(mask));
+   }
+}
+
+//return false if str doesn't follow the syntax, or has a distance over RANGE_MAX_DISTANCE
+bool parse_range(astd::string_view str, range_mask& result);
+
+//shortest string form, "X-Y" ranges joined by ':'
+std::string serialize_range(range_mask mask);
+
+#endif //!RANGE_MASK_HPP
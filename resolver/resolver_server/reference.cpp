@@ -1,11 +1,40 @@
 #include "reference.hpp"
-#include "boost/lexical_cast.hpp"
+#include "diagnostics.hpp"
+#include <cstring>
 
 const std::array<astd::string_view, reference::SIZE> reference::converter_array =
 {
    "NUL", "ORD", "UNI", "DUN", "PLY", "DTI", "ATT", "DEF"
 };
 
+constexpr std::uint32_t reference::prefix_keys[8];
+constexpr std::uint32_t reference::prefix_types[8];
+
+static_assert(reference::decode_prefix('N', 'U', 'L') == reference::NUL, "prefix table broken");
+static_assert(reference::decode_prefix('O', 'R', 'D') == reference::ORD, "prefix table broken");
+static_assert(reference::decode_prefix('U', 'N', 'I') == reference::UNI, "prefix table broken");
+static_assert(reference::decode_prefix('D', 'U', 'N') == reference::DUN, "prefix table broken");
+static_assert(reference::decode_prefix('P', 'L', 'Y') == reference::PLY, "prefix table broken");
+static_assert(reference::decode_prefix('D', 'T', 'I') == reference::DTI, "prefix table broken");
+static_assert(reference::decode_prefix('A', 'T', 'T') == reference::ATT, "prefix table broken");
+static_assert(reference::decode_prefix('D', 'E', 'F') == reference::DEF, "prefix table broken");
+static_assert(reference::decode_prefix('U', 'N', 'X') == reference::NUL, "prefix table broken");
+
+namespace
+{
+   const char digit_pairs[201] =
+      "00010203040506070809"
+      "10111213141516171819"
+      "20212223242526272829"
+      "30313233343536373839"
+      "40414243444546474849"
+      "50515253545556575859"
+      "60616263646566676869"
+      "70717273747576777879"
+      "80818283848586878889"
+      "90919293949596979899";
+}
+
 std::ostream& operator<<(std::ostream& stream, const reference& ref)
 {
    stream << ref.serialize().data();
@@ -14,26 +43,28 @@ std::ostream& operator<<(std::ostream& stream, const reference& ref)
 
 reference::reference(astd::string_view str)
 {
-   auto ref_type = str.substr(0, PREFIX_SIZE - 1);
-   auto num_found = str.substr(PREFIX_SIZE - 1);
-   auto it = std::find(converter_array.begin(), converter_array.end(), ref_type);
-
-   if (it != converter_array.end())
+   T_type ref_type = NUL;
+   if (str.size() >= PREFIX_SIZE - 1)
    {
-      type = static_cast<T_type>(std::distance(converter_array.begin(), it));
+      ref_type = decode_prefix(str[0], str[1], str[2]);
    }
-   else
+
+   if (ref_type == NUL && str.substr(0, PREFIX_SIZE - 1) != converter_array[NUL])
    {
-      std::cerr << "ERROR: reference type " << ref_type << " not known" << std::endl;
-      type = NUL;
+      diagnostics::global().report(diagnostics::REFERENCE_UNKNOWN, str.substr(0, PREFIX_SIZE - 1));
    }
 
-   num = xts::fast_str_to_uint(num_found);
+   auto num = str.size() >= PREFIX_SIZE - 1 ? xts::fast_str_to_uint(str.substr(PREFIX_SIZE - 1)) : 0;
+   _value = (std::uint32_t(ref_type) << NUM_BITS) | (std::uint32_t(num) & NUM_MASK);
 }
 
+reference::reference(T_type type, std::uint32_t num)
+   : _value((std::uint32_t(type) << NUM_BITS) | (num & NUM_MASK))
+{}
+
 bool reference::operator ==(const reference& rval) const
 {
-   return type == rval.type && num == rval.num;
+   return _value == rval._value;
 }
 
 bool reference::operator!=(const reference& rval) const
@@ -43,20 +74,43 @@ bool reference::operator!=(const reference& rval) const
 
 bool reference::operator<(const reference& rval) const
 {
-   return type < rval.type && num < rval.num;
+   return _value < rval._value;
 }
 
-std::array<char, reference::PREFIX_SIZE + 5> reference::serialize() const
+std::size_t reference::serialize(char* out) const
 {
-   std::array<char, PREFIX_SIZE + 5> result = { 0 };
-   std::array<char, 6> filled_number;
-   std::fill(filled_number.begin(), filled_number.end(), '0');
-   filled_number[5] = '\0';
+   std::memcpy(out, converter_array[type()].data(), PREFIX_SIZE - 1);
+   out += PREFIX_SIZE - 1;
+
+   auto value = num();
+   if (value < 100000)
+   {
+      //common case : exactly NUM_DIGITS digits
+      auto high = value / 100;
+      auto low = value % 100;
+      out[0] = static_cast<char>('0' + high / 100);
+      std::memcpy(out + 1, digit_pairs + (high % 100) * 2, 2);
+      std::memcpy(out + 3, digit_pairs + low * 2, 2);
+      return PREFIX_SIZE - 1 + NUM_DIGITS;
+   }
 
-   auto number_start = std::copy(converter_array[type].begin(), converter_array[type].begin() + PREFIX_SIZE - 1, result.begin());
+   char digits[10];
+   std::size_t size = 0;
+   while (value)
+   {
+      digits[size++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+   }
+   for (std::size_t i = 0; i < size; ++i)
+   {
+      out[i] = digits[size - 1 - i];
+   }
+   return PREFIX_SIZE - 1 + size;
+}
 
-   auto number = boost::lexical_cast<std::array<char, 6>>(num);
-   std::copy(number.rbegin() + (number.size() - std::strlen(number.data())), number.rend(), filled_number.rbegin() + 1); //let's place the number at the end of the string but not erasing the /0
-   std::copy(filled_number.begin(), filled_number.end(), number_start);
+std::array<char, reference::SERIALIZED_SIZE> reference::serialize() const
+{
+   std::array<char, SERIALIZED_SIZE> result = { { 0 } };
+   serialize(result.data());
    return result;
-}
\ No newline at end of file
+}
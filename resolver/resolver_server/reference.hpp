@@ -3,12 +3,22 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iterator>
 #include <iostream>
-#include "boost/lexical_cast.hpp"
 #include "astring_view.hpp"
 #include "fast_convert.hpp"
 
+//3 characters prefix as an integer key, one byte per character
+constexpr std::uint32_t reference_prefix_key(char c0, char c1, char c2)
+{
+   return std::uint32_t(static_cast<unsigned char>(c0))
+      | std::uint32_t(static_cast<unsigned char>(c1)) << 8
+      | std::uint32_t(static_cast<unsigned char>(c2)) << 16;
+}
+
+// AAA00000 identifier packed on 32 bits : the type in the high bits, the number in the low bits
 struct reference
 {
 public:
@@ -26,12 +36,12 @@ public:
       SIZE //keep this one at the end
    };
 
-   T_type type = NUL;
-   std::size_t num = 0;
-
    enum
    {
-      PREFIX_SIZE = 4
+      PREFIX_SIZE = 4,
+      NUM_DIGITS = 5, //numbers are padded to this amount of digits
+      NUM_BITS = 28,
+      SERIALIZED_SIZE = PREFIX_SIZE - 1 + 9 + 1 //prefix, up to 9 digits for 28 bits, '\0'
    };
 
    static const std::array<astd::string_view, SIZE> converter_array;
@@ -40,15 +50,81 @@ public:
 
    reference(astd::string_view str);
 
+   reference(T_type type, std::uint32_t num);
+
+   T_type type() const
+   {
+      return static_cast<T_type>(_value >> NUM_BITS);
+   }
+
+   std::uint32_t num() const
+   {
+      return _value & NUM_MASK;
+   }
+
+   std::uint32_t packed() const
+   {
+      return _value;
+   }
+
    bool operator ==(const reference& rval) const;
 
    bool operator!=(const reference& rval) const;
 
    bool operator<(const reference& rval) const;
 
-   std::array<char, PREFIX_SIZE + 5> serialize() const;
+   //write the reference at out without '\0', return the amount of characters written (8 for 5 digits numbers)
+   std::size_t serialize(char* out) const;
+
+   std::array<char, SERIALIZED_SIZE> serialize() const;
+
+   //perfect hash of the 8 prefixes on 3 bits, the result still has to be checked against prefix_keys
+   static constexpr std::uint32_t prefix_slot(std::uint32_t key)
+   {
+      return std::uint32_t(key * PREFIX_HASH) >> 29;
+   }
+
+   //NUL for an unknown prefix, without any branch
+   static constexpr T_type decode_prefix(char c0, char c1, char c2)
+   {
+      return static_cast<T_type>(prefix_types[prefix_slot(reference_prefix_key(c0, c1, c2))]
+         & (0u - std::uint32_t(prefix_keys[prefix_slot(reference_prefix_key(c0, c1, c2))] == reference_prefix_key(c0, c1, c2))));
+   }
+
+private:
+   enum : std::uint32_t
+   {
+      NUM_MASK = (1u << NUM_BITS) - 1,
+      PREFIX_HASH = 0x1c5e
+   };
+
+   static constexpr std::uint32_t prefix_keys[8] =
+   {
+      reference_prefix_key('U', 'N', 'I'), reference_prefix_key('D', 'T', 'I'), reference_prefix_key('A', 'T', 'T'), reference_prefix_key('N', 'U', 'L'),
+      reference_prefix_key('O', 'R', 'D'), reference_prefix_key('D', 'U', 'N'), reference_prefix_key('D', 'E', 'F'), reference_prefix_key('P', 'L', 'Y')
+   };
+
+   static constexpr std::uint32_t prefix_types[8] =
+   {
+      UNI, DTI, ATT, NUL, ORD, DUN, DEF, PLY
+   };
+
+   std::uint32_t _value = 0;
 };
 
 std::ostream& operator<<(std::ostream& stream, const reference& ref);
 
+namespace std
+{
+   template<>
+   struct hash<reference>
+   {
+      std::size_t operator()(const reference& ref) const
+      {
+         //fibonacci hashing, the high half of the product mixes the type and the number
+         return static_cast<std::size_t>((std::uint64_t(ref.packed()) * 0x9E3779B97F4A7C15ull) >> 32);
+      }
+   };
+}
+
 #endif //!REFERENCE_HPP
@@ -0,0 +1,76 @@
+#include "reference_index.hpp"
+
+void reference_index::reserve(std::size_t count)
+{
+   //keep the load factor under 1/2, linear probing degrades quickly above it
+   std::size_t capacity = 16;
+   while (capacity < count * 2)
+   {
+      capacity *= 2;
+   }
+
+   if (capacity <= _slots.size())
+   {
+      return;
+   }
+
+   std::vector<slot> old_slots(capacity);
+   old_slots.swap(_slots);
+   for (const auto& current : old_slots)
+   {
+      if (current.pos != npos)
+      {
+         _slots[probe(current.key)] = current;
+      }
+   }
+}
+
+std::size_t reference_index::find(const reference& ref) const
+{
+   if (_slots.empty())
+   {
+      return npos;
+   }
+   return _slots[probe(ref)].pos;
+}
+
+std::pair<std::size_t, bool> reference_index::insert(const reference& ref, std::size_t pos)
+{
+   if ((_size + 1) * 2 > _slots.size())
+   {
+      reserve(_size + 1);
+   }
+
+   auto& current = _slots[probe(ref)];
+   if (current.pos != npos)
+   {
+      return{ current.pos, false };
+   }
+
+   current.key = ref;
+   current.pos = pos;
+   ++_size;
+   return{ pos, true };
+}
+
+std::size_t reference_index::size() const
+{
+   return _size;
+}
+
+void reference_index::clear()
+{
+   _slots.clear();
+   _size = 0;
+}
+
+std::size_t reference_index::probe(const reference& ref) const
+{
+   const std::size_t mask = _slots.size() - 1;
+   std::size_t i = std::hash<reference>()(ref) & mask;
+   while (_slots[i].pos != npos && _slots[i].key != ref)
+   {
+      i = (i + 1) & mask;
+   }
+   return i;
+}
@@ -0,0 +1,45 @@
+#ifndef REFERENCE_INDEX_HPP
+#define REFERENCE_INDEX_HPP
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "reference.hpp"
+
+// open addressing (linear probing) map from a reference to a position in a container
+// meant to be sized once from the number of elements about to be inserted
+class reference_index
+{
+public:
+   enum : std::size_t
+   {
+      npos = std::numeric_limits<std::size_t>::max()
+   };
+
+   //make room for count elements in total, rehash only if the current table is too small
+   void reserve(std::size_t count);
+
+   std::size_t find(const reference& ref) const;
+
+   //return the position already stored for ref, or store pos and return it
+   std::pair<std::size_t, bool> insert(const reference& ref, std::size_t pos);
+
+   std::size_t size() const;
+
+   void clear();
+
+private:
+   struct slot
+   {
+      reference key;
+      std::size_t pos = npos;
+   };
+
+   std::vector<slot> _slots;
+   std::size_t _size = 0;
+
+   std::size_t probe(const reference& ref) const;
+};
+
+#endif //!REFERENCE_INDEX_HPP
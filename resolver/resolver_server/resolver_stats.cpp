@@ -0,0 +1,99 @@
+#include "resolver_stats.hpp"
+#include "json_writer.hpp"
+#include "task_scheduler.hpp"
+#include <fstream>
+#include <vector>
+
+const char* const resolver_stats::filename = "resolver_stats.json";
+
+const std::array<const char*, resolver_stats::PHASE_SIZE> resolver_stats::phase_names =
+{ {
+   "action_points",
+   "orders",
+   "dead_after_orders",
+   "close_combat",
+   "dead_after_close_combat"
+} };
+
+const std::array<const char*, resolver_stats::COUNTER_SIZE> resolver_stats::counter_names =
+{ {
+   "path_expansions",
+   "terrain_lookups",
+   "definition_lookups",
+   "unit_lookups",
+   "contested_tiles",
+   "casualties"
+} };
+
+void resolver_stats::reset()
+{
+   *this = resolver_stats();
+}
+
+resolver_stats::counter_block& resolver_stats::local_counters()
+{
+   static thread_local counter_block block = { { 0 } };
+   return block;
+}
+
+void resolver_stats::collect_thread_counters()
+{
+   auto& scheduler = task_scheduler::global();
+   std::vector<counter_block> blocks(scheduler.thread_count());
+   scheduler.for_each_thread([&blocks](std::size_t slot)
+   {
+      auto& local = local_counters();
+      blocks[slot] = local;
+      local.fill(0);
+   });
+
+   for (const auto& block : blocks)
+   {
+      for (std::size_t i = 0; i < COUNTER_SIZE; ++i)
+      {
+         counters[i] += block[i];
+      }
+   }
+}
+
+int resolver_stats::dump(const astd::filesystem::path& path, std::int32_t turn) const
+{
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
+   if (!stream)
+   {
+      return OPEN_FILE;
+   }
+
+   json_writer writer(stream);
+   writer.begin_object();
+   writer.key("counters").begin_object();
+   for (std::size_t i = 0; i < COUNTER_SIZE; ++i)
+   {
+      writer.key(counter_names[i]).value(std::int64_t(counters[i]));
+   }
+   writer.end_object();
+
+   writer.key("orders").begin_object();
+   for (std::size_t i = 0; i < order::SIZE; ++i)
+   {
+      writer.key(order::serialize(static_cast<order::T_type>(i))).begin_object();
+      writer.key("executed").value(std::int64_t(orders_executed[i]));
+      writer.key("rejected").value(std::int64_t(orders_rejected[i]));
+      writer.end_object();
+   }
+   writer.end_object();
+
+   double total = 0.;
+   writer.key("phases_us").begin_object();
+   for (std::size_t i = 0; i < PHASE_SIZE; ++i)
+   {
+      writer.key(phase_names[i]).value(phase_us[i]);
+      total += phase_us[i];
+   }
+   writer.end_object();
+
+   writer.key("total_us").value(total);
+   writer.key("turn").value(turn);
+   writer.end_object();
+   return writer.flush() ? NONE : OPEN_FILE;
+}
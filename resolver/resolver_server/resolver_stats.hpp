@@ -0,0 +1,100 @@
+#ifndef RESOLVER_STATS_HPP
+#define RESOLVER_STATS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include "afilesystem.hpp"
+#include "data.hpp"
+#include "resolver_config.hpp"
+
+// wall time per phase of game_resolver::resolve and counters of the work done during a turn
+// recording goes through the RESOLVER_STATS_* macros, they expand to nothing when the
+// RESOLVER_STATS cmake option is off
+struct resolver_stats
+{
+   enum T_phase
+   {
+      ACTION_POINTS,
+      ORDERS,
+      DEAD_AFTER_ORDERS,
+      CLOSE_COMBAT,
+      DEAD_AFTER_CLOSE_COMBAT,
+      PHASE_SIZE
+   };
+
+   enum T_counter
+   {
+      PATH_EXPANSIONS,
+      TERRAIN_LOOKUPS,
+      DEFINITION_LOOKUPS,
+      UNIT_LOOKUPS,
+      CONTESTED_TILES,
+      CASUALTIES,
+      COUNTER_SIZE
+   };
+
+   enum error_code : int
+   {
+      NONE = 0,
+      OPEN_FILE = 1
+   };
+
+   static const char* const filename;
+   static const std::array<const char*, PHASE_SIZE> phase_names;
+   static const std::array<const char*, COUNTER_SIZE> counter_names;
+
+   std::array<double, PHASE_SIZE> phase_us = { { 0. } };
+   std::array<std::uint64_t, order::SIZE> orders_executed = { { 0 } };
+   std::array<std::uint64_t, order::SIZE> orders_rejected = { { 0 } };
+   using counter_block = std::array<std::uint64_t, COUNTER_SIZE>;
+   counter_block counters = { { 0 } };
+
+   void reset();
+
+   //counters of the calling thread, bumped by RESOLVER_STATS_COUNT without synchronization
+   static counter_block& local_counters();
+   //add then clear the local_counters() of every task_scheduler thread, at the end of each phase
+   //to call from the thread that built the scheduler, outside of a task
+   void collect_thread_counters();
+
+   //write the stats at path, resolver_stats::filename in the output directory
+   int dump(const astd::filesystem::path& path, std::int32_t turn) const;
+
+   //add the time spent in its scope to a phase, then collect the counters of the phase
+   class phase_timer
+   {
+   public:
+      phase_timer(resolver_stats& stats, T_phase phase)
+         : _stats(stats), _phase(phase), _start(std::chrono::steady_clock::now())
+      {}
+
+      ~phase_timer()
+      {
+         _stats.phase_us[_phase] += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _start).count();
+         _stats.collect_thread_counters();
+      }
+
+      phase_timer(const phase_timer&) = delete;
+      phase_timer& operator=(const phase_timer&) = delete;
+
+   private:
+      resolver_stats& _stats;
+      T_phase _phase;
+      std::chrono::steady_clock::time_point _start;
+   };
+};
+
+#ifdef RESOLVER_STATS
+#define RESOLVER_STATS_PHASE(stats, phase) resolver_stats::phase_timer resolver_stats_phase_timer_##phase((stats), resolver_stats::phase)
+#define RESOLVER_STATS_COUNT(counter) (++resolver_stats::local_counters()[resolver_stats::counter])
+#define RESOLVER_STATS_ADD(counter, num) (resolver_stats::local_counters()[resolver_stats::counter] += (num))
+#define RESOLVER_STATS_ORDER(stats, type, rejected) (++((rejected) ? (stats).orders_rejected : (stats).orders_executed)[(type)])
+#else
+#define RESOLVER_STATS_PHASE(stats, phase) ((void)0)
+#define RESOLVER_STATS_COUNT(counter) ((void)0)
+#define RESOLVER_STATS_ADD(counter, num) ((void)0)
+#define RESOLVER_STATS_ORDER(stats, type, rejected) ((void)0)
+#endif
+
+#endif //!RESOLVER_STATS_HPP
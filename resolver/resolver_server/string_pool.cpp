@@ -0,0 +1,37 @@
+#include "string_pool.hpp"
+#include <cstring>
+
+astd::string_view string_pool::intern(astd::string_view str)
+{
+   if (str.empty())
+   {
+      return astd::string_view();
+   }
+
+   if (str.size() > _block_capacity - _block_used)
+   {
+      //oversized strings get their own block, the current one stays open
+      if (str.size() > BLOCK_SIZE / 4)
+      {
+         _large_blocks.emplace_back(new char[str.size()]);
+         std::memcpy(_large_blocks.back().get(), str.data(), str.size());
+         _size += str.size();
+         return astd::string_view(_large_blocks.back().get(), str.size());
+      }
+
+      _blocks.emplace_back(new char[BLOCK_SIZE]);
+      _block_used = 0;
+      _block_capacity = BLOCK_SIZE;
+   }
+
+   char* dest = _blocks.back().get() + _block_used;
+   std::memcpy(dest, str.data(), str.size());
+   _block_used += str.size();
+   _size += str.size();
+   return astd::string_view(dest, str.size());
+}
+
+std::size_t string_pool::size() const
+{
+   return _size;
+}
@@ -0,0 +1,36 @@
+#ifndef STRING_POOL_HPP
+#define STRING_POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "astring_view.hpp"
+
+// append only arena for the text fields of the definitions (name, description, texture)
+// the views returned stay valid as long as the pool lives, game_data shares its pool between copies
+class string_pool
+{
+public:
+   enum
+   {
+      BLOCK_SIZE = 64 * 1024
+   };
+
+   string_pool() = default;
+   string_pool(const string_pool&) = delete;
+   string_pool& operator=(const string_pool&) = delete;
+
+   //copy str in the pool
+   astd::string_view intern(astd::string_view str);
+
+   std::size_t size() const;
+
+private:
+   std::vector<std::unique_ptr<char[]>> _blocks;
+   std::vector<std::unique_ptr<char[]>> _large_blocks;
+   std::size_t _block_used = 0;
+   std::size_t _block_capacity = 0;
+   std::size_t _size = 0;
+};
+
+#endif //!STRING_POOL_HPP
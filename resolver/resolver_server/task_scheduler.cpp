@@ -0,0 +1,275 @@
+#include "task_scheduler.hpp"
+#include <algorithm>
+#include <cassert>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+   std::size_t configured_threads = 0;
+   bool configured_pin = false;
+
+   thread_local const task_scheduler* current_scheduler = nullptr;
+   thread_local std::size_t current_slot_index = 0;
+
+   const std::size_t npos = static_cast<std::size_t>(-1);
+
+   //bind the calling thread to one core
+   void pin_current_thread(std::size_t slot)
+   {
+#ifdef __linux__
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(slot % std::max(1u, std::thread::hardware_concurrency()), &set);
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+      (void)slot;
+#endif
+   }
+}
+
+bool task_scheduler::work_deque::push(task* t)
+{
+   auto bottom = _bottom.load(std::memory_order_relaxed);
+   auto top = _top.load(std::memory_order_acquire);
+   if (bottom - top >= CAPACITY)
+   {
+      return false;
+   }
+   _tasks[bottom & (CAPACITY - 1)].store(t, std::memory_order_relaxed);
+   //publishes the task to the thieves, they load _bottom with acquire
+   _bottom.store(bottom + 1, std::memory_order_release);
+   return true;
+}
+
+task_scheduler::task* task_scheduler::work_deque::pop()
+{
+   auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+   _bottom.store(bottom, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   auto top = _top.load(std::memory_order_relaxed);
+
+   if (top > bottom)
+   {
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+   }
+
+   auto result = _tasks[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+   if (top == bottom)
+   {
+      //last task, race against the thieves
+      if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      {
+         result = nullptr;
+      }
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+   }
+   return result;
+}
+
+task_scheduler::task* task_scheduler::work_deque::steal()
+{
+   auto top = _top.load(std::memory_order_acquire);
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   auto bottom = _bottom.load(std::memory_order_acquire);
+   if (top >= bottom)
+   {
+      return nullptr;
+   }
+
+   auto result = _tasks[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+   if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+   {
+      return nullptr;
+   }
+   return result;
+}
+
+void task_scheduler::configure(std::size_t thread_count, bool pin)
+{
+   configured_threads = thread_count;
+   configured_pin = pin;
+}
+
+task_scheduler& task_scheduler::global()
+{
+   static task_scheduler scheduler(configured_threads, configured_pin);
+   return scheduler;
+}
+
+task_scheduler::task_scheduler(std::size_t thread_count, bool pin)
+   : _pin(pin)
+{
+   if (thread_count == 0)
+   {
+      thread_count = std::max(1u, std::thread::hardware_concurrency());
+   }
+
+   _mailboxes.reset(new std::atomic<task*>[thread_count]);
+   for (std::size_t i = 0; i < thread_count; ++i)
+   {
+      _deques.emplace_back(new work_deque());
+      _mailboxes[i].store(nullptr, std::memory_order_relaxed);
+   }
+
+   current_scheduler = this;
+   current_slot_index = 0;
+   if (_pin)
+   {
+      pin_current_thread(0);
+   }
+
+   for (std::size_t i = 1; i < thread_count; ++i)
+   {
+      _workers.emplace_back(&task_scheduler::worker_loop, this, i);
+   }
+}
+
+task_scheduler::~task_scheduler()
+{
+   {
+      std::lock_guard<std::mutex> lock(_sleep_mutex);
+      _stop = true;
+   }
+   _wake.notify_all();
+   for (auto& worker : _workers)
+   {
+      worker.join();
+   }
+   if (current_scheduler == this)
+   {
+      current_scheduler = nullptr;
+   }
+}
+
+std::size_t task_scheduler::thread_count() const
+{
+   return _deques.size();
+}
+
+std::size_t task_scheduler::current_slot() const
+{
+   return current_scheduler == this ? current_slot_index : npos;
+}
+
+void task_scheduler::spawn(task* t)
+{
+   auto slot = current_slot();
+   if (slot == npos || thread_count() == 1 || !_deques[slot]->push(t))
+   {
+      //foreign thread, no worker or full deque : run it right away
+      t->func();
+      t->group->_pending.fetch_sub(1, std::memory_order_release);
+      delete t;
+      return;
+   }
+
+   _queued.fetch_add(1);
+   if (_sleeping.load())
+   {
+      //a worker between its last look at _queued and its wait holds the mutex
+      std::lock_guard<std::mutex> lock(_sleep_mutex);
+   }
+   _wake.notify_one();
+}
+
+void task_scheduler::for_each_thread(const std::function<void(std::size_t)>& func)
+{
+   auto slot = current_slot();
+   assert(slot == 0);
+
+   task_group group(*this);
+   for (std::size_t i = 1; i < thread_count(); ++i)
+   {
+      group._pending.fetch_add(1, std::memory_order_relaxed);
+      _mailboxes[i].store(new task{ [&func, i]() { func(i); }, &group }, std::memory_order_release);
+      _queued.fetch_add(1);
+   }
+   if (thread_count() > 1)
+   {
+      std::lock_guard<std::mutex> lock(_sleep_mutex);
+      _wake.notify_all();
+   }
+
+   func(slot);
+   group.wait();
+}
+
+bool task_scheduler::run_one(std::size_t slot)
+{
+   task* t = nullptr;
+   if (slot != npos)
+   {
+      t = _mailboxes[slot].exchange(nullptr, std::memory_order_acquire);
+   }
+   if (!t && slot != npos)
+   {
+      t = _deques[slot]->pop();
+   }
+   for (std::size_t i = 1; !t && i <= _deques.size(); ++i)
+   {
+      auto victim = ((slot == npos ? 0 : slot) + i) % _deques.size();
+      if (victim != slot)
+      {
+         t = _deques[victim]->steal();
+      }
+   }
+   if (!t)
+   {
+      return false;
+   }
+
+   _queued.fetch_sub(1);
+   t->func();
+   t->group->_pending.fetch_sub(1, std::memory_order_release);
+   delete t;
+   return true;
+}
+
+void task_scheduler::worker_loop(std::size_t slot)
+{
+   current_scheduler = this;
+   current_slot_index = slot;
+   if (_pin)
+   {
+      pin_current_thread(slot);
+   }
+
+   while (!_stop.load())
+   {
+      if (run_one(slot))
+      {
+         continue;
+      }
+
+      std::unique_lock<std::mutex> lock(_sleep_mutex);
+      _sleeping.fetch_add(1);
+      _wake.wait(lock, [this]() { return _stop.load() || _queued.load() != 0; });
+      _sleeping.fetch_sub(1);
+   }
+}
+
+task_scheduler::task_group::task_group(task_scheduler& scheduler)
+   : _scheduler(scheduler)
+{}
+
+task_scheduler::task_group::~task_group()
+{
+   wait();
+}
+
+void task_scheduler::task_group::wait()
+{
+   auto slot = _scheduler.current_slot();
+   while (_pending.load(std::memory_order_acquire) != 0)
+   {
+      if (!_scheduler.run_one(slot))
+      {
+         std::this_thread::yield();
+      }
+   }
+}
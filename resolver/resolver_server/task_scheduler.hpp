@@ -0,0 +1,154 @@
+#ifndef TASK_SCHEDULER_HPP
+#define TASK_SCHEDULER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// work stealing thread pool shared by the parser, the resolver phases and the dumper
+// every thread has a Chase-Lev deque : it pushes and pops its own tasks at the bottom,
+// idle threads steal from the top of the others. the thread that builds the scheduler
+// is one of the threads, it runs tasks while it waits on a task_group
+// a thread_count of 1 runs everything inline on the calling thread
+class task_scheduler
+{
+public:
+   class task_group;
+
+   //thread_count 0 : std::thread::hardware_concurrency(), pin : one core per thread (linux only)
+   //to call before the first global(), ignored afterward
+   static void configure(std::size_t thread_count, bool pin = false);
+   static task_scheduler& global();
+
+   task_scheduler(std::size_t thread_count, bool pin = false);
+   ~task_scheduler();
+
+   task_scheduler(const task_scheduler&) = delete;
+   task_scheduler& operator=(const task_scheduler&) = delete;
+
+   std::size_t thread_count() const;
+
+   //call func(i) for i in [begin, end), split in tasks of at least grain indices
+   //returns once every call is done, func must not depend on the order of the calls
+   template<typename F>
+   void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, const F& func);
+
+   //call func(slot) once on every thread of the scheduler, for their thread_local state
+   //returns once every call is done. to call from the thread that built the scheduler, outside of a task
+   void for_each_thread(const std::function<void(std::size_t)>& func);
+
+private:
+   struct task
+   {
+      std::function<void()> func;
+      task_group* group;
+   };
+
+   //fixed capacity Chase-Lev deque, see "Correct and Efficient Work-Stealing for Weak Memory Models"
+   class work_deque
+   {
+   public:
+      enum : std::int64_t
+      {
+         CAPACITY = 1 << 12
+      };
+
+      //owner only, return false when full
+      bool push(task* t);
+      //owner only
+      task* pop();
+      //any thread
+      task* steal();
+
+   private:
+      std::atomic<std::int64_t> _top{ 0 };
+      std::atomic<std::int64_t> _bottom{ 0 };
+      std::unique_ptr<std::atomic<task*>[]> _tasks{ new std::atomic<task*>[CAPACITY] };
+   };
+
+   std::vector<std::unique_ptr<work_deque>> _deques; //slot 0 belongs to the thread that built the scheduler
+   std::unique_ptr<std::atomic<task*>[]> _mailboxes; //task for one given slot, taken before its deque
+   std::vector<std::thread> _workers;
+   bool _pin = false;
+   std::atomic<std::size_t> _queued{ 0 };
+   std::atomic<std::size_t> _sleeping{ 0 };
+   std::atomic<bool> _stop{ false };
+   std::mutex _sleep_mutex;
+   std::condition_variable _wake;
+
+   //slot of the calling thread in this scheduler, npos if it isn't one of its threads
+   std::size_t current_slot() const;
+   void spawn(task* t);
+   //pop a task of slot, or steal one, and run it. return false if no task was found
+   bool run_one(std::size_t slot);
+   void worker_loop(std::size_t slot);
+
+   template<typename F>
+   void split(task_group& group, std::size_t begin, std::size_t end, std::size_t grain, const F& func);
+};
+
+// tasks run on the scheduler, wait() helps running tasks until they are all done
+// the destructor waits as well
+class task_scheduler::task_group
+{
+public:
+   explicit task_group(task_scheduler& scheduler = task_scheduler::global());
+   ~task_group();
+
+   task_group(const task_group&) = delete;
+   task_group& operator=(const task_group&) = delete;
+
+   template<typename F>
+   void run(F&& func)
+   {
+      _pending.fetch_add(1, std::memory_order_relaxed);
+      _scheduler.spawn(new task{ std::function<void()>(std::forward<F>(func)), this });
+   }
+
+   void wait();
+
+private:
+   friend class task_scheduler;
+
+   task_scheduler& _scheduler;
+   std::atomic<std::size_t> _pending{ 0 };
+};
+
+template<typename F>
+void task_scheduler::parallel_for(std::size_t begin, std::size_t end, std::size_t grain, const F& func)
+{
+   if (grain == 0)
+      grain = 1;
+   if (end <= begin + grain || thread_count() == 1)
+   {
+      for (auto i = begin; i < end; ++i)
+         func(i);
+      return;
+   }
+
+   task_group group(*this);
+   split(group, begin, end, grain, func);
+   group.wait();
+}
+
+template<typename F>
+void task_scheduler::split(task_group& group, std::size_t begin, std::size_t end, std::size_t grain, const F& func)
+{
+   //the upper halves are left to the thieves, the calling thread keeps going down
+   while (end - begin > grain)
+   {
+      auto middle = begin + (end - begin) / 2;
+      group.run([this, &group, middle, end, grain, &func]() { split(group, middle, end, grain, func); });
+      end = middle;
+   }
+   for (auto i = begin; i < end; ++i)
+      func(i);
+}
+
+#endif //!TASK_SCHEDULER_HPP
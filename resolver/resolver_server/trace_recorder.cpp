@@ -0,0 +1,131 @@
+#include "trace_recorder.hpp"
+#include "json_writer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+namespace
+{
+   const std::chrono::steady_clock::time_point trace_epoch = std::chrono::steady_clock::now();
+
+   //buffers outlive their thread, the dumper threads are gone when the trace is written
+   std::mutex registry_mutex;
+   std::vector<std::unique_ptr<trace_buffer>> registry;
+}
+
+std::atomic<bool> trace_recorder::_enabled{ false };
+
+trace_buffer::trace_buffer(std::uint32_t thread_id)
+   : _events(CAPACITY), _thread_id(thread_id)
+{}
+
+void trace_buffer::push(const trace_event& event)
+{
+   auto head = _head.load(std::memory_order_relaxed);
+   _events[head & (CAPACITY - 1)] = event;
+   _head.store(head + 1, std::memory_order_release);
+}
+
+std::vector<trace_event> trace_buffer::snapshot() const
+{
+   auto head = _head.load(std::memory_order_acquire);
+   auto first = head > CAPACITY ? head - CAPACITY : 0;
+   std::vector<trace_event> result;
+   result.reserve(static_cast<std::size_t>(head - first));
+   for (auto i = first; i < head; ++i)
+   {
+      result.push_back(_events[i & (CAPACITY - 1)]);
+   }
+   return result;
+}
+
+std::uint32_t trace_buffer::thread_id() const
+{
+   return _thread_id;
+}
+
+void trace_recorder::enable(bool enabled)
+{
+   _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::uint64_t trace_recorder::now_ns()
+{
+   return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_epoch).count());
+}
+
+trace_buffer& trace_recorder::local()
+{
+   thread_local trace_buffer* buffer = nullptr;
+   if (!buffer)
+   {
+      std::lock_guard<std::mutex> lock(registry_mutex);
+      registry.emplace_back(new trace_buffer(static_cast<std::uint32_t>(registry.size() + 1)));
+      buffer = registry.back().get();
+   }
+   return *buffer;
+}
+
+int trace_recorder::write(const astd::filesystem::path& path)
+{
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
+   if (!stream)
+   {
+      return OPEN_FILE;
+   }
+
+   std::lock_guard<std::mutex> lock(registry_mutex);
+   json_writer writer(stream);
+   writer.begin_object();
+   writer.key("displayTimeUnit").value("ns");
+   writer.key("traceEvents").begin_array();
+   for (const auto& buffer : registry)
+   {
+      for (const auto& event : buffer->snapshot())
+      {
+         writer.begin_object();
+         writer.key("name").value(event.name);
+         writer.key("cat").value("resolver");
+         writer.key("ph").value("X");
+         writer.key("pid").value(std::int32_t(1));
+         writer.key("tid").value(buffer->thread_id());
+         writer.key("ts").value(event.start_ns / 1000.);
+         writer.key("dur").value(event.duration_ns / 1000.);
+         writer.key("args").begin_object();
+         if (event.ref.type() != reference::NUL)
+         {
+            writer.key("ref").value(event.ref);
+         }
+         if (event.label)
+         {
+            writer.key("type").value(event.label);
+         }
+         if (event.has_position)
+         {
+            writer.key("x").value(event.x);
+            writer.key("y").value(event.y);
+         }
+         if (event.has_value)
+         {
+            writer.key("value").value(event.value);
+         }
+         if (event.detail[0])
+         {
+            writer.key("detail").value(event.detail.data());
+         }
+         writer.end_object();
+         writer.end_object();
+      }
+   }
+   writer.end_array();
+   writer.end_object();
+   return writer.flush() ? NONE : OPEN_FILE;
+}
+
+void trace_scope::set_detail(astd::string_view detail)
+{
+   auto size = std::min<std::size_t>(detail.size(), trace_event::DETAIL_SIZE - 1);
+   std::memcpy(_event.detail.data(), detail.data(), size);
+   _event.detail[size] = 0;
+}
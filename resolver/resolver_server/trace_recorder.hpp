@@ -0,0 +1,129 @@
+#ifndef TRACE_RECORDER_HPP
+#define TRACE_RECORDER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "afilesystem.hpp"
+#include "astring_view.hpp"
+#include "reference.hpp"
+
+// timeline of a resolution written in the chrome trace format (chrome://tracing, ui.perfetto.dev)
+// disabled by default, a disabled scope costs one relaxed atomic load
+// every thread records in its own ring buffer without locking, the oldest events are
+// overwritten when a buffer is full. write() must run once the recording threads are done
+struct trace_event
+{
+   enum
+   {
+      DETAIL_SIZE = 48
+   };
+
+   const char* name = nullptr; //static string
+   std::uint64_t start_ns = 0;
+   std::uint64_t duration_ns = 0;
+   reference ref;
+   const char* label = nullptr; //static string
+   std::int32_t x = 0;
+   std::int32_t y = 0;
+   float value = 0.f;
+   bool has_position = false;
+   bool has_value = false;
+   std::array<char, DETAIL_SIZE> detail = { { 0 } };
+};
+
+class trace_buffer
+{
+public:
+   enum
+   {
+      CAPACITY = 1 << 16
+   };
+
+   explicit trace_buffer(std::uint32_t thread_id);
+
+   //single producer : only the owning thread pushes
+   void push(const trace_event& event);
+
+   //events still in the buffer, oldest first
+   std::vector<trace_event> snapshot() const;
+
+   std::uint32_t thread_id() const;
+
+private:
+   std::vector<trace_event> _events;
+   std::atomic<std::uint64_t> _head{ 0 };
+   std::uint32_t _thread_id;
+};
+
+class trace_recorder
+{
+public:
+   enum error_code : int
+   {
+      NONE = 0,
+      OPEN_FILE = 1
+   };
+
+   static void enable(bool enabled = true);
+
+   static bool enabled()
+   {
+      return _enabled.load(std::memory_order_relaxed);
+   }
+
+   static std::uint64_t now_ns();
+
+   //buffer of the calling thread, registered on first use
+   static trace_buffer& local();
+
+   static int write(const astd::filesystem::path& path);
+
+private:
+   static std::atomic<bool> _enabled;
+};
+
+//record the time spent in its scope, the setters add the arguments shown with the event
+class trace_scope
+{
+public:
+   explicit trace_scope(const char* name)
+      : _active(trace_recorder::enabled())
+   {
+      if (_active)
+      {
+         _event.name = name;
+         _event.start_ns = trace_recorder::now_ns();
+      }
+   }
+
+   ~trace_scope()
+   {
+      if (_active)
+      {
+         _event.duration_ns = trace_recorder::now_ns() - _event.start_ns;
+         trace_recorder::local().push(_event);
+      }
+   }
+
+   trace_scope(const trace_scope&) = delete;
+   trace_scope& operator=(const trace_scope&) = delete;
+
+   bool active() const { return _active; }
+
+   void set_ref(const reference& ref) { _event.ref = ref; }
+   void set_label(const char* label) { _event.label = label; }
+   void set_position(std::int32_t x, std::int32_t y) { _event.x = x; _event.y = y; _event.has_position = true; }
+   void set_value(float value) { _event.value = value; _event.has_value = true; }
+   //truncated to trace_event::DETAIL_SIZE - 1 characters
+   void set_detail(astd::string_view detail);
+
+private:
+   bool _active;
+   trace_event _event;
+};
+
+#endif //!TRACE_RECORDER_HPP
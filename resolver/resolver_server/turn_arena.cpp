@@ -0,0 +1,79 @@
+#include "turn_arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+void* turn_arena::allocate(std::size_t size, std::size_t alignment)
+{
+   if (!size)
+   {
+      size = 1;
+   }
+
+   for (;;)
+   {
+      if (_current < _blocks.size())
+      {
+         auto& current = _blocks[_current];
+         auto address = reinterpret_cast<std::uintptr_t>(current.data.get()) + _offset;
+         auto padding = (alignment - address % alignment) % alignment;
+         if (_offset + padding + size <= current.size)
+         {
+            _offset += padding + size;
+            _used += size;
+            return reinterpret_cast<void*>(address + padding);
+         }
+      }
+      next_block(size + alignment);
+   }
+}
+
+void turn_arena::release()
+{
+   //keep the first blocks for the next turn, drop the excess of a peak turn
+   std::size_t retained = 0;
+   auto it = std::find_if(_blocks.begin(), _blocks.end(), [&retained](const block& current)
+   {
+      retained += current.size;
+      return retained > RETAINED_SIZE;
+   });
+   _blocks.erase(it, _blocks.end());
+
+   _current = 0;
+   _offset = 0;
+   _used = 0;
+}
+
+std::size_t turn_arena::used() const
+{
+   return _used;
+}
+
+turn_arena& turn_arena::local()
+{
+   static thread_local turn_arena arena;
+   return arena;
+}
+
+void turn_arena::next_block(std::size_t min_size)
+{
+   if (_current < _blocks.size())
+   {
+      ++_current;
+   }
+   _offset = 0;
+
+   //reuse the blocks retained from a previous turn when they are big enough
+   while (_current < _blocks.size() && _blocks[_current].size < min_size)
+   {
+      ++_current;
+   }
+
+   if (_current >= _blocks.size())
+   {
+      block new_block;
+      new_block.size = std::max<std::size_t>(BLOCK_SIZE, min_size);
+      new_block.data.reset(new char[new_block.size]);
+      _blocks.emplace_back(std::move(new_block));
+      _current = _blocks.size() - 1;
+   }
+}
@@ -0,0 +1,147 @@
+#ifndef TURN_ARENA_HPP
+#define TURN_ARENA_HPP
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <set>
+#include <vector>
+#include "boost/container/flat_map.hpp"
+
+// monotonic allocator for the temporaries of one turn resolution
+// deallocation is a no-op, everything is given back at once by release()
+// one instance per thread, see turn_arena::local()
+class turn_arena
+{
+public:
+   enum
+   {
+      BLOCK_SIZE = 256 * 1024,
+      RETAINED_SIZE = 16 * 1024 * 1024 //memory kept after release() for the next turn
+   };
+
+   class scope;
+
+   turn_arena() = default;
+   turn_arena(const turn_arena&) = delete;
+   turn_arena& operator=(const turn_arena&) = delete;
+
+   void* allocate(std::size_t size, std::size_t alignment);
+
+   //invalidate every allocation made since the last release
+   void release();
+
+   //bytes handed out since the last release
+   std::size_t used() const;
+
+   static turn_arena& local();
+
+private:
+   struct block
+   {
+      std::unique_ptr<char[]> data;
+      std::size_t size = 0;
+   };
+
+   std::vector<block> _blocks;
+   std::size_t _current = 0;
+   std::size_t _offset = 0;
+   std::size_t _used = 0;
+
+   void next_block(std::size_t min_size);
+};
+
+// gives back on destruction every allocation made on the arena since its construction
+// for the temporaries of a query, which may run outside of a turn resolution
+class turn_arena::scope
+{
+public:
+   explicit scope(turn_arena& arena = turn_arena::local())
+      : _arena(arena), _current(arena._current), _offset(arena._offset), _used(arena._used)
+   {}
+
+   ~scope()
+   {
+      _arena._current = _current;
+      _arena._offset = _offset;
+      _arena._used = _used;
+   }
+
+   scope(const scope&) = delete;
+   scope& operator=(const scope&) = delete;
+
+private:
+   turn_arena& _arena;
+   std::size_t _current;
+   std::size_t _offset;
+   std::size_t _used;
+};
+
+template<typename T>
+class arena_allocator
+{
+public:
+   typedef T value_type;
+
+   arena_allocator()
+      : _arena(&turn_arena::local())
+   {}
+
+   explicit arena_allocator(turn_arena& arena)
+      : _arena(&arena)
+   {}
+
+   template<typename U>
+   arena_allocator(const arena_allocator<U>& other)
+      : _arena(other.arena())
+   {}
+
+   T* allocate(std::size_t count)
+   {
+      return static_cast<T*>(_arena->allocate(count * sizeof(T), alignof(T)));
+   }
+
+   void deallocate(T*, std::size_t)
+   {}
+
+   turn_arena* arena() const
+   {
+      return _arena;
+   }
+
+   template<typename U>
+   struct rebind
+   {
+      typedef arena_allocator<U> other;
+   };
+
+private:
+   turn_arena* _arena;
+};
+
+template<typename T, typename U>
+bool operator==(const arena_allocator<T>& lval, const arena_allocator<U>& rval)
+{
+   return lval.arena() == rval.arena();
+}
+
+template<typename T, typename U>
+bool operator!=(const arena_allocator<T>& lval, const arena_allocator<U>& rval)
+{
+   return !(lval == rval);
+}
+
+template<typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+template<typename T>
+using arena_deque = std::deque<T, arena_allocator<T>>;
+
+template<typename T>
+using arena_set = std::set<T, std::less<T>, arena_allocator<T>>;
+
+template<typename K, typename V>
+using arena_flat_map = boost::container::flat_map<K, V, std::less<K>, arena_allocator<std::pair<K, V>>>;
+
+#endif //!TURN_ARENA_HPP
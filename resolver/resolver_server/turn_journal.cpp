@@ -0,0 +1,323 @@
+#include "turn_journal.hpp"
+#include "json_writer.hpp"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+const char* const turn_journal::filename = "turn_journal.bin";
+const char* const turn_journal::json_filename = "turn_journal.json";
+
+const std::array<const char*, turn_journal::SIZE> turn_journal::event_names =
+{ {
+   "MOVE",
+   "SHOT",
+   "DAMAGE",
+   "RETREAT",
+   "DEATH",
+   "ORDER_REJECTED"
+} };
+
+namespace
+{
+   const char magic[4] = { 'R', 'T', 'J', '1' };
+
+   enum T_field
+   {
+      FIELD_OTHER = 1,
+      FIELD_POSITION = 2,
+      FIELD_AMOUNT = 4
+   };
+
+   //fields written after the type and the unit of every record
+   const std::array<int, turn_journal::SIZE> event_fields =
+   { {
+      FIELD_POSITION,
+      FIELD_OTHER | FIELD_POSITION,
+      FIELD_OTHER | FIELD_AMOUNT,
+      FIELD_POSITION,
+      0,
+      FIELD_AMOUNT | FIELD_POSITION
+   } };
+
+   std::uint64_t zigzag(std::int64_t num)
+   {
+      return (std::uint64_t(num) << 1) ^ std::uint64_t(num >> 63);
+   }
+
+   std::int64_t unzigzag(std::uint64_t num)
+   {
+      return std::int64_t(num >> 1) ^ -std::int64_t(num & 1);
+   }
+
+   class varint_reader
+   {
+   public:
+      varint_reader(const std::uint8_t* data, std::size_t size)
+         : _data(data), _end(data + size)
+      {}
+
+      bool done() const { return _data == _end; }
+
+      bool get(std::uint64_t& result)
+      {
+         result = 0;
+         for (unsigned shift = 0; _data != _end && shift < 64; shift += 7)
+         {
+            auto byte = *_data++;
+            result |= std::uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+               return true;
+         }
+         return false;
+      }
+
+      bool get_signed(std::int32_t& result)
+      {
+         std::uint64_t num = 0;
+         bool ok = get(num);
+         result = static_cast<std::int32_t>(unzigzag(num));
+         return ok;
+      }
+
+      //the type in the low bits keeps the small numbers on one or two bytes
+      bool get_reference(reference& result)
+      {
+         std::uint64_t num = 0;
+         bool ok = get(num);
+         result = reference(static_cast<reference::T_type>(num & 0xF), static_cast<std::uint32_t>(num >> 4));
+         return ok;
+      }
+
+      const std::uint8_t* position() const { return _data; }
+      std::size_t remaining() const { return static_cast<std::size_t>(_end - _data); }
+
+   private:
+      const std::uint8_t* _data;
+      const std::uint8_t* _end;
+   };
+}
+
+void turn_journal::move(const reference& unit, const coordinate& destination)
+{
+   event ev;
+   ev.type = MOVE;
+   ev.unit = unit;
+   ev.x = destination.x;
+   ev.y = destination.y;
+   record(ev);
+}
+
+void turn_journal::shot(const reference& attacker, const reference& attack, const coordinate& target)
+{
+   event ev;
+   ev.type = SHOT;
+   ev.unit = attacker;
+   ev.other = attack;
+   ev.x = target.x;
+   ev.y = target.y;
+   record(ev);
+}
+
+void turn_journal::damage(const reference& unit, const reference& attacker, std::int32_t amount)
+{
+   event ev;
+   ev.type = DAMAGE;
+   ev.unit = unit;
+   ev.other = attacker;
+   ev.amount = amount;
+   record(ev);
+}
+
+void turn_journal::retreat(const reference& unit, const coordinate& destination)
+{
+   event ev;
+   ev.type = RETREAT;
+   ev.unit = unit;
+   ev.x = destination.x;
+   ev.y = destination.y;
+   record(ev);
+}
+
+void turn_journal::death(const reference& unit)
+{
+   event ev;
+   ev.type = DEATH;
+   ev.unit = unit;
+   record(ev);
+}
+
+void turn_journal::order_rejected(const reference& unit, const order& ord)
+{
+   event ev;
+   ev.type = ORDER_REJECTED;
+   ev.unit = unit;
+   ev.amount = ord.type;
+   ev.x = ord.target.x;
+   ev.y = ord.target.y;
+   record(ev);
+}
+
+const std::vector<std::uint8_t>& turn_journal::records() const
+{
+   return _records;
+}
+
+std::size_t turn_journal::size() const
+{
+   return _size;
+}
+
+void turn_journal::clear()
+{
+   _records.clear();
+   _size = 0;
+}
+
+int turn_journal::write(const astd::filesystem::path& path, std::int32_t turn) const
+{
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
+   if (!stream)
+   {
+      return OPEN_FILE;
+   }
+
+   std::uint8_t header[sizeof(magic) + 10];
+   std::memcpy(header, magic, sizeof(magic));
+   std::size_t header_size = sizeof(magic);
+   for (auto num = zigzag(turn); ; num >>= 7)
+   {
+      header[header_size++] = static_cast<std::uint8_t>((num & 0x7F) | (num >= 0x80 ? 0x80 : 0));
+      if (num < 0x80)
+         break;
+   }
+
+   stream.write(reinterpret_cast<const char*>(header), header_size);
+   stream.write(reinterpret_cast<const char*>(_records.data()), _records.size());
+   return stream ? NONE : OPEN_FILE;
+}
+
+int turn_journal::read(const astd::filesystem::path& path, std::int32_t& turn, std::vector<event>& result)
+{
+   std::ifstream stream(path.c_str(), std::ios::binary);
+   if (!stream)
+   {
+      return OPEN_FILE;
+   }
+
+   std::vector<std::uint8_t> content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+   if (content.size() < sizeof(magic) || std::memcmp(content.data(), magic, sizeof(magic)))
+   {
+      return BAD_FORMAT;
+   }
+
+   varint_reader reader(content.data() + sizeof(magic), content.size() - sizeof(magic));
+   if (!reader.get_signed(turn))
+   {
+      return BAD_FORMAT;
+   }
+
+   return decode(reader.position(), reader.remaining(), result);
+}
+
+int turn_journal::decode(const std::uint8_t* data, std::size_t size, std::vector<event>& result)
+{
+   varint_reader reader(data, size);
+   while (!reader.done())
+   {
+      event ev;
+      std::uint64_t type = 0;
+      if (!reader.get(type) || type >= SIZE || !reader.get_reference(ev.unit))
+      {
+         return BAD_FORMAT;
+      }
+      ev.type = static_cast<T_event>(type);
+
+      auto fields = event_fields[ev.type];
+      bool ok = true;
+      if (fields & FIELD_OTHER)
+         ok = ok && reader.get_reference(ev.other);
+      if (fields & FIELD_POSITION)
+         ok = ok && reader.get_signed(ev.x) && reader.get_signed(ev.y);
+      if (fields & FIELD_AMOUNT)
+         ok = ok && reader.get_signed(ev.amount);
+      if (!ok)
+      {
+         return BAD_FORMAT;
+      }
+      result.push_back(ev);
+   }
+   return NONE;
+}
+
+int turn_journal::export_json(const std::vector<event>& events, std::int32_t turn, const astd::filesystem::path& path)
+{
+   std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
+   if (!stream)
+   {
+      return OPEN_FILE;
+   }
+
+   json_writer writer(stream);
+   writer.begin_object();
+   writer.key("events").begin_array();
+   for (const auto& ev : events)
+   {
+      auto fields = event_fields[ev.type];
+      writer.begin_object();
+      if (ev.type == DAMAGE)
+         writer.key("amount").value(ev.amount);
+      if (ev.type == ORDER_REJECTED)
+         writer.key("order").value(order::serialize(static_cast<order::T_type>(ev.amount)));
+      if (fields & FIELD_OTHER)
+         writer.key(ev.type == SHOT ? "attack" : "attacker").value(ev.other);
+      writer.key("type").value(event_names[ev.type]);
+      writer.key("unit").value(ev.unit);
+      if (fields & FIELD_POSITION)
+      {
+         writer.key("x").value(ev.x);
+         writer.key("y").value(ev.y);
+      }
+      writer.end_object();
+   }
+   writer.end_array();
+   writer.key("turn").value(turn);
+   writer.end_object();
+   return writer.flush() ? NONE : OPEN_FILE;
+}
+
+void turn_journal::record(const event& ev)
+{
+   auto fields = event_fields[ev.type];
+   put_varint(ev.type);
+   put_reference(ev.unit);
+   if (fields & FIELD_OTHER)
+      put_reference(ev.other);
+   if (fields & FIELD_POSITION)
+   {
+      put_signed(ev.x);
+      put_signed(ev.y);
+   }
+   if (fields & FIELD_AMOUNT)
+      put_signed(ev.amount);
+   ++_size;
+}
+
+void turn_journal::put_varint(std::uint64_t num)
+{
+   while (num >= 0x80)
+   {
+      _records.push_back(static_cast<std::uint8_t>(num | 0x80));
+      num >>= 7;
+   }
+   _records.push_back(static_cast<std::uint8_t>(num));
+}
+
+void turn_journal::put_reference(const reference& ref)
+{
+   put_varint((std::uint64_t(ref.num()) << 4) | ref.type());
+}
+
+void turn_journal::put_signed(std::int64_t num)
+{
+   put_varint(zigzag(num));
+}
@@ -0,0 +1,78 @@
+#ifndef TURN_JOURNAL_HPP
+#define TURN_JOURNAL_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "afilesystem.hpp"
+#include "data.hpp"
+#include "reference.hpp"
+
+// what happened during a turn, one record per event, in the order of the resolution
+// a record is the event type followed by its fields, every number is a LEB128 varint,
+// signed numbers are zigzag encoded first, references are (num << 4 | type)
+// the file starts with the magic "RTJ1" and the turn
+class turn_journal
+{
+public:
+   enum T_event
+   {
+      MOVE, //unit, destination
+      SHOT, //attacker, attack, target tile
+      DAMAGE, //damaged unit, attacker, endurance lost
+      RETREAT, //unit, destination
+      DEATH, //unit
+      ORDER_REJECTED, //unit, order type, target
+      SIZE
+   };
+
+   enum error_code : int
+   {
+      NONE = 0,
+      OPEN_FILE = 1,
+      BAD_FORMAT = 2
+   };
+
+   struct event
+   {
+      T_event type = SIZE;
+      reference unit;
+      reference other;
+      std::int32_t x = 0;
+      std::int32_t y = 0;
+      std::int32_t amount = 0;
+   };
+
+   static const char* const filename;
+   static const char* const json_filename;
+   static const std::array<const char*, SIZE> event_names;
+
+   void move(const reference& unit, const coordinate& destination);
+   void shot(const reference& attacker, const reference& attack, const coordinate& target);
+   void damage(const reference& unit, const reference& attacker, std::int32_t amount);
+   void retreat(const reference& unit, const coordinate& destination);
+   void death(const reference& unit);
+   void order_rejected(const reference& unit, const order& ord);
+
+   const std::vector<std::uint8_t>& records() const;
+   std::size_t size() const; //amount of events
+   void clear();
+
+   int write(const astd::filesystem::path& path, std::int32_t turn) const;
+
+   //read a journal file, events are appended to result
+   static int read(const astd::filesystem::path& path, std::int32_t& turn, std::vector<event>& result);
+   static int decode(const std::uint8_t* data, std::size_t size, std::vector<event>& result);
+   static int export_json(const std::vector<event>& events, std::int32_t turn, const astd::filesystem::path& path);
+
+private:
+   std::vector<std::uint8_t> _records;
+   std::size_t _size = 0;
+
+   void record(const event& ev);
+   void put_varint(std::uint64_t num);
+   void put_signed(std::int64_t num);
+   void put_reference(const reference& ref);
+};
+
+#endif //!TURN_JOURNAL_HPP
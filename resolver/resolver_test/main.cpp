@@ -0,0 +1,533 @@
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "afilesystem.hpp"
+#include "data.hpp"
+#include "data_parser.hpp"
+#include "data_dumper.hpp"
+#include "diagnostics.hpp"
+#include "resolver_stats.hpp"
+#include "turn_journal.hpp"
+#include "game_resolver.hpp"
+#include "scenario_generator.hpp"
+
+// regression tests of the resolver, run by ctest
+// resolver_test <test name> <scenario directory> : returns 0 when the test passes
+
+static std::string read_file(const astd::filesystem::path& path)
+{
+	std::ifstream stream(path.c_str(), std::ios::binary);
+	std::ostringstream content;
+	content << stream.rdbuf();
+	return content.str();
+}
+
+//every file of expected but the turn manifest must have the same bytes in actual
+static bool same_files(const astd::filesystem::path& expected, const astd::filesystem::path& actual)
+{
+	bool result = true;
+	std::size_t compared = 0;
+	for (const auto& entry : astd::filesystem::directory_iterator(expected))
+	{
+		auto filename = entry.path().filename();
+		if (filename == data_dumper::manifest_filename)
+			continue;
+
+		++compared;
+		if (!astd::filesystem::exists(actual / filename))
+		{
+			std::cerr << "FAILED : " << (actual / filename) << " is missing" << std::endl;
+			result = false;
+		}
+		else if (read_file(entry.path()) != read_file(actual / filename))
+		{
+			std::cerr << "FAILED : " << entry.path() << " and " << (actual / filename) << " differ" << std::endl;
+			result = false;
+		}
+	}
+	if (!compared)
+	{
+		std::cerr << "FAILED : nothing dumped in " << expected << std::endl;
+		result = false;
+	}
+	return result;
+}
+
+static astd::filesystem::path work_directory(const std::string& test_name)
+{
+	auto result = astd::filesystem::temp_directory_path() / "resolver_test" / test_name;
+	astd::filesystem::remove_all(result);
+	astd::filesystem::create_directories(result);
+	return result;
+}
+
+//a section kept from the previous dump must hold the bytes a new serialization would write,
+//a dump of another FORMAT_VERSION is never kept
+static int test_dump_reuse(const astd::filesystem::path& scenario)
+{
+	auto work_dir = work_directory("dump_reuse");
+	data_parser parser(scenario, order_file_index::NO_TURN);
+	game_resolver resolver(parser.get());
+
+	//no section hash : every file is serialized
+	game_data serialized = resolver.data();
+	serialized.digest = section_digest();
+	if (data_dumper(serialized, work_dir / "serialized").status() != data_dumper::NONE)
+	{
+		std::cerr << "FAILED : dump of " << scenario << " without section hashes" << std::endl;
+		return 1;
+	}
+
+	//the second dump finds the manifest of the first one and keeps the unchanged sections
+	for (int turn = 0; turn < 2; ++turn)
+	{
+		if (data_dumper(resolver.data(), work_dir / "reused").status() != data_dumper::NONE)
+		{
+			std::cerr << "FAILED : dump " << turn << " of " << scenario << std::endl;
+			return 1;
+		}
+		if (!same_files(work_dir / "serialized", work_dir / "reused"))
+			return 1;
+	}
+
+	//files of another dumper layout, under a manifest without version or of another version, are written again
+	auto manifest_path = work_dir / "reused" / data_dumper::manifest_filename;
+	auto manifest = read_file(manifest_path);
+	auto version = std::string("\"format_version\":") + std::to_string(data_dumper::FORMAT_VERSION) + ",";
+	auto version_pos = manifest.find(version);
+	if (version_pos == std::string::npos)
+	{
+		std::cerr << "FAILED : no " << version << " in " << manifest_path << std::endl;
+		return 1;
+	}
+	for (const auto& replacement : { std::string(), std::string("\"format_version\":1,") })
+	{
+		auto old_manifest = manifest;
+		old_manifest.replace(version_pos, version.size(), replacement);
+		std::ofstream(astd::filesystem::path(manifest_path).c_str(), std::ios::binary) << old_manifest;
+		for (const auto& entry : astd::filesystem::directory_iterator(work_dir / "reused"))
+		{
+			if (entry.path().filename() != data_dumper::manifest_filename)
+				std::ofstream(entry.path().c_str(), std::ios::binary) << "{\"old_layout\":true}";
+		}
+
+		if (data_dumper(resolver.data(), work_dir / "reused").status() != data_dumper::NONE)
+		{
+			std::cerr << "FAILED : dump of " << scenario << " over an old layout" << std::endl;
+			return 1;
+		}
+		if (!same_files(work_dir / "serialized", work_dir / "reused"))
+			return 1;
+	}
+	return 0;
+}
+
+//resolve then dump scenario in output, with its journal
+static bool resolve_and_dump(const astd::filesystem::path& scenario, const resolver_options& options, const astd::filesystem::path& output)
+{
+	data_parser parser(scenario, order_file_index::NO_TURN);
+	game_resolver resolver(parser.get(), true, options);
+	std::vector<data_dumper::extra_file> extra_files;
+	extra_files.push_back({ turn_journal::filename, [&](const astd::filesystem::path& path)
+	{
+		return resolver.journal().write(path, parser.turn());
+	} });
+	if (data_dumper(resolver.data(), output, false, extra_files).status() != data_dumper::NONE)
+	{
+		std::cerr << "FAILED : dump of " << scenario << " in " << output << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//the Morton order of the units is a memory layout, the turn must not depend on it
+static int test_morton_order(const astd::filesystem::path& scenario)
+{
+	auto work_dir = work_directory("morton_order");
+
+	//enough stacked units for ties on the action points and contested tiles
+	scenario_parameters params;
+	params.diameter = 12;
+	params.players = 4;
+	params.units_per_player = 100;
+	params.stack_density = 2.f;
+	params.seed = 7;
+	if (write_scenario(generate_scenario(params), work_dir / "generated") != data_dumper::NONE)
+	{
+		std::cerr << "FAILED : writing the generated scenario" << std::endl;
+		return 1;
+	}
+
+	int result = 0;
+	for (const auto& input : { scenario, work_dir / "generated" })
+	{
+		for (bool batched : { false, true })
+		{
+			resolver_options options;
+			options.batched_orders = batched;
+			auto output = work_dir / "output" / (input.filename().string() + (batched ? "_batched" : ""));
+			if (!resolve_and_dump(input, options, output))
+				return 1;
+
+			options.morton_order = true;
+			auto morton_output = output;
+			morton_output += "_morton";
+			if (!resolve_and_dump(input, options, morton_output))
+				return 1;
+
+			if (!same_files(output, morton_output))
+				result = 1;
+		}
+	}
+	return result;
+}
+
+//copy the json files of scenario in a new work directory
+static astd::filesystem::path copy_scenario(const astd::filesystem::path& scenario, const std::string& test_name)
+{
+	auto result = work_directory(test_name);
+	for (const auto& entry : astd::filesystem::directory_iterator(scenario))
+	{
+		if (entry.path().extension() == ".json")
+			astd::filesystem::copy_file(entry.path(), result / entry.path().filename());
+	}
+	return result;
+}
+
+//a coordinate that doesn't fit in coordinate is reported by the parser, not truncated
+static int test_coordinate_range(const astd::filesystem::path& scenario)
+{
+	auto work_dir = copy_scenario(scenario, "coordinate_range");
+
+	data_parser valid(work_dir, order_file_index::NO_TURN);
+	if (valid.status() != data_parser::NONE)
+	{
+		std::cerr << "FAILED : parsing " << scenario << std::endl;
+		return 1;
+	}
+
+	//the first position of the units file moved out of the map and out of the int16 range
+	auto units = read_file(work_dir / "unit.json");
+	auto position = units.find("\"position\"");
+	auto end = units.find(']', position);
+	if (position == std::string::npos || end == std::string::npos)
+	{
+		std::cerr << "FAILED : no unit position in " << scenario << std::endl;
+		return 1;
+	}
+	units.replace(position, end + 1 - position, "\"position\":[40000,-40000]");
+	std::ofstream(astd::filesystem::path(work_dir / "unit.json").c_str(), std::ios::binary) << units;
+
+	data_parser out_of_range(work_dir, order_file_index::NO_TURN);
+	if (!(out_of_range.status() & data_parser::COORDINATE_OUT_OF_RANGE))
+	{
+		std::cerr << "FAILED : position 40000 -40000 accepted" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+//two tiles far apart on both sides of the map must not allocate their whole bounding box
+static int test_sparse_map(const astd::filesystem::path& scenario)
+{
+	auto work_dir = copy_scenario(scenario, "sparse_map");
+	auto map_file = read_file(work_dir / "map.json");
+	auto tiles = map_file.find("\"tiles\"");
+	auto first_tile = map_file.find('[', tiles) + 1;
+	if (tiles == std::string::npos || first_tile == std::string::npos + 1)
+	{
+		std::cerr << "FAILED : no tiles in " << scenario << std::endl;
+		return 1;
+	}
+	map_file.insert(first_tile, "[[-30000,-30000],\"DTI00001\"],[[30000,30000],\"DTI00002\"],");
+	std::ofstream(astd::filesystem::path(work_dir / "map.json").c_str(), std::ios::binary) << map_file;
+
+	data_parser parser(work_dir, order_file_index::NO_TURN);
+	if (parser.status() != data_parser::NONE)
+	{
+		std::cerr << "FAILED : parsing " << work_dir << std::endl;
+		return 1;
+	}
+	game_resolver resolver(parser.get(), false);
+	const auto& data = resolver.data();
+	const auto& current_map = data.current_map;
+	if (!current_map.tile_terrain.empty() || current_map.tile_sorted.empty())
+	{
+		std::cerr << "FAILED : dense terrain table of " << current_map.tile_terrain.size() << " tiles for a sparse map" << std::endl;
+		return 1;
+	}
+
+	//the first tile of the grid wins, as in the dense table
+	int result = 0;
+	for (const auto& tile : current_map.grid)
+	{
+		auto first = std::find_if(current_map.grid.begin(), current_map.grid.end(), [&tile](const auto& other) { return other.first == tile.first; });
+		auto index = current_map.terrain_index(tile.first);
+		if (index == NO_INDEX || data.terrains[index].id != first->second)
+		{
+			std::cerr << "FAILED : wrong terrain at " << tile.first << std::endl;
+			result = 1;
+		}
+	}
+	for (const auto& outside : { coordinate(-30000, 30000), coordinate(0, 30000), coordinate(-29999, -30000) })
+	{
+		if (current_map.terrain_index(outside) != NO_INDEX)
+		{
+			std::cerr << "FAILED : terrain found at " << outside << " out of the map" << std::endl;
+			result = 1;
+		}
+	}
+
+	resolver.resolve();
+	if (data_dumper(resolver.data(), work_dir / "output").status() != data_dumper::NONE)
+	{
+		std::cerr << "FAILED : dump of " << work_dir << std::endl;
+		result = 1;
+	}
+	return result;
+}
+
+//with the output directory set to the input one, the files of the resolver are never taken for inputs
+//and the order manifest is replaced as a whole
+static int test_output_in_input(const astd::filesystem::path& scenario)
+{
+	auto work_dir = copy_scenario(scenario, "output_in_input");
+	for (int turn = 0; turn < 2; ++turn)
+	{
+		//the warnings of the parser are kept apart to be checked
+		std::ostringstream warnings;
+		auto cerr_buffer = std::cerr.rdbuf(warnings.rdbuf());
+		data_parser parser(work_dir, order_file_index::NO_TURN);
+		std::cerr.rdbuf(cerr_buffer);
+		if (parser.status() != data_parser::NONE || warnings.str().find("not recognized") != std::string::npos)
+		{
+			std::cerr << "FAILED : parsing " << work_dir << " at turn " << turn << " : " << warnings.str() << std::endl;
+			return 1;
+		}
+
+		game_resolver resolver(parser.get());
+		std::vector<data_dumper::extra_file> extra_files;
+		extra_files.push_back({ resolver_stats::filename, [&](const astd::filesystem::path& path) { return resolver.stats().dump(path, parser.turn()); } });
+		extra_files.push_back({ diagnostics::filename, [](const astd::filesystem::path& path) { return diagnostics::global().dump(path); } });
+		extra_files.push_back({ turn_journal::filename, [&](const astd::filesystem::path& path) { return resolver.journal().write(path, parser.turn()); } });
+		extra_files.push_back({ turn_journal::json_filename, [&](const astd::filesystem::path& path)
+		{
+			std::vector<turn_journal::event> events;
+			int status = turn_journal::decode(resolver.journal().records().data(), resolver.journal().records().size(), events);
+			return status != turn_journal::NONE ? status : turn_journal::export_json(events, parser.turn(), path);
+		} });
+		if (data_dumper(resolver.data(), work_dir, false, extra_files).status() != data_dumper::NONE
+			|| parser.commit_turn() != data_parser::NONE)
+		{
+			std::cerr << "FAILED : dump of " << work_dir << " at turn " << turn << std::endl;
+			return 1;
+		}
+
+		auto manifest_path = work_dir / order_file_index::manifest_filename;
+		order_file_index manifest;
+		if (astd::filesystem::exists(astd::filesystem::path(manifest_path.string() + ".tmp"))
+			|| manifest.load_manifest(work_dir) != order_file_index::NONE
+			|| manifest.last_consumed_turn() != parser.turn())
+		{
+			std::cerr << "FAILED : " << manifest_path << " doesn't record the turn " << parser.turn() << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//syntax of the attack ranges : parsed masks, rejected strings and serialize / parse round trips
+static int test_range_syntax(const astd::filesystem::path&)
+{
+	int result = 0;
+	const std::vector<std::pair<std::string, range_mask>> accepted =
+	{
+		{ "0-1:4", 0x13 },
+		{ "3", 0x8 },
+		{ "2-5", 0x3C },
+		{ "0", 0x1 },
+		{ "63", range_mask(1) << 63 },
+		{ "0-63", ~range_mask(0) },
+		{ "1-4:3-6", 0x7E }, //overlapping
+		{ "1-2:3-4", 0x1E }, //adjacent
+		{ "4:2-3", 0x1C },
+		{ "5-5", 0x20 },
+	};
+	for (const auto& test : accepted)
+	{
+		range_mask mask = 0;
+		if (!parse_range(test.first, mask) || mask != test.second)
+		{
+			std::cerr << "FAILED : \"" << test.first << "\" parsed as " << std::hex << mask << std::dec << std::endl;
+			result = 1;
+		}
+	}
+
+	const std::vector<std::string> rejected = { "5-2", "64", "0-64", "100", "", "1::2", "1:", ":1", "-", "1-", "-1", "a", "1-b", "1 " };
+	for (const auto& test : rejected)
+	{
+		range_mask mask = 1;
+		if (parse_range(test, mask) || mask != 0)
+		{
+			std::cerr << "FAILED : \"" << test << "\" accepted" << std::endl;
+			result = 1;
+		}
+	}
+
+	//the masks of the accepted strings and pseudo random ones survive a round trip, with the bit scans
+	std::vector<range_mask> masks;
+	for (const auto& test : accepted)
+		masks.push_back(test.second);
+	std::uint64_t state = 0x9E3779B97F4A7C15ull;
+	for (int i = 0; i < 1000; ++i)
+	{
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		masks.push_back(state & (state >> (i % 64)));
+	}
+	for (auto mask : masks)
+	{
+		auto text = serialize_range(mask);
+		range_mask parsed = 0;
+		if (mask && (!parse_range(text, parsed) || parsed != mask))
+		{
+			std::cerr << "FAILED : " << std::hex << mask << std::dec << " serialized as \"" << text << "\"" << std::endl;
+			result = 1;
+		}
+
+		std::uint32_t lowest = 0, highest = 0, count = 0;
+		for (std::uint32_t distance = 0; distance <= RANGE_MAX_DISTANCE; ++distance)
+		{
+			if (range_contains(mask, distance))
+			{
+				lowest = count++ ? lowest : distance;
+				highest = distance;
+			}
+		}
+		if (range_lowest(mask) != lowest || range_highest(mask) != highest || range_count(mask) != count)
+		{
+			std::cerr << "FAILED : bit scans of " << std::hex << mask << std::dec << std::endl;
+			result = 1;
+		}
+	}
+	return result;
+}
+
+//every event of the binary journal is read back as recorded, a truncated journal is refused
+static int test_journal_round_trip(const astd::filesystem::path&)
+{
+	auto work_dir = work_directory("journal_round_trip");
+	const reference unit(reference::UNI, (1u << reference::NUM_BITS) - 1);
+	const reference other_unit(reference::UNI, 1);
+	const reference attack(reference::ATT, 123456);
+	order rejected;
+	rejected.type = order::FIRE;
+	rejected.target = coordinate(-32767, 32766);
+
+	//records().size() after each event : the only sizes a complete journal can have
+	turn_journal journal;
+	std::vector<std::size_t> boundaries = { 0 };
+	journal.move(unit, coordinate(-30000, 12));
+	boundaries.push_back(journal.records().size());
+	journal.shot(unit, attack, coordinate(5, -7));
+	boundaries.push_back(journal.records().size());
+	journal.damage(other_unit, unit, 2000000000);
+	boundaries.push_back(journal.records().size());
+	journal.retreat(other_unit, coordinate(-1, -1));
+	boundaries.push_back(journal.records().size());
+	journal.death(unit);
+	boundaries.push_back(journal.records().size());
+	journal.order_rejected(other_unit, rejected);
+	boundaries.push_back(journal.records().size());
+
+	std::vector<turn_journal::event> expected(turn_journal::SIZE);
+	expected[0] = { turn_journal::MOVE, unit, reference(), -30000, 12, 0 };
+	expected[1] = { turn_journal::SHOT, unit, attack, 5, -7, 0 };
+	expected[2] = { turn_journal::DAMAGE, other_unit, unit, 0, 0, 2000000000 };
+	expected[3] = { turn_journal::RETREAT, other_unit, reference(), -1, -1, 0 };
+	expected[4] = { turn_journal::DEATH, unit, reference(), 0, 0, 0 };
+	expected[5] = { turn_journal::ORDER_REJECTED, other_unit, reference(), -32767, 32766, order::FIRE };
+
+	auto same_events = [&expected](const std::vector<turn_journal::event>& events)
+	{
+		if (events.size() != expected.size())
+			return false;
+		for (std::size_t i = 0; i < events.size(); ++i)
+		{
+			const auto& lval = events[i];
+			const auto& rval = expected[i];
+			if (lval.type != rval.type || lval.unit != rval.unit || lval.other != rval.other
+				|| lval.x != rval.x || lval.y != rval.y || lval.amount != rval.amount)
+				return false;
+		}
+		return true;
+	};
+
+	const std::int32_t turn = -3;
+	auto path = work_dir / turn_journal::filename;
+	std::int32_t read_turn = 0;
+	std::vector<turn_journal::event> events;
+	if (journal.write(path, turn) != turn_journal::NONE
+		|| turn_journal::read(path, read_turn, events) != turn_journal::NONE
+		|| read_turn != turn || !same_events(events))
+	{
+		std::cerr << "FAILED : " << path << " not read back as written" << std::endl;
+		return 1;
+	}
+
+	int result = 0;
+	const auto& records = journal.records();
+	for (std::size_t size = 0; size <= records.size(); ++size)
+	{
+		events.clear();
+		bool complete = std::find(boundaries.begin(), boundaries.end(), size) != boundaries.end();
+		auto status = turn_journal::decode(records.data(), size, events);
+		if (status != (complete ? turn_journal::NONE : turn_journal::BAD_FORMAT))
+		{
+			std::cerr << "FAILED : decode of the first " << size << " bytes returned " << status << std::endl;
+			result = 1;
+		}
+	}
+
+	//a file cut in the magic, in the turn or in the last record
+	auto content = read_file(path);
+	for (auto size : { std::size_t(3), std::size_t(4), content.size() - 1 })
+	{
+		std::ofstream(path.c_str(), std::ios::binary | std::ios::trunc) << content.substr(0, size);
+		events.clear();
+		if (turn_journal::read(path, read_turn, events) != turn_journal::BAD_FORMAT)
+		{
+			std::cerr << "FAILED : " << path << " cut after " << size << " bytes accepted" << std::endl;
+			result = 1;
+		}
+	}
+	return result;
+}
+
+int main(int argc, char ** argv)
+{
+	const std::map<std::string, int(*)(const astd::filesystem::path&)> tests =
+	{
+		{ "coordinate_range", &test_coordinate_range },
+		{ "dump_reuse", &test_dump_reuse },
+		{ "journal_round_trip", &test_journal_round_trip },
+		{ "morton_order", &test_morton_order },
+		{ "output_in_input", &test_output_in_input },
+		{ "range_syntax", &test_range_syntax },
+		{ "sparse_map", &test_sparse_map },
+	};
+
+	auto test = argc == 3 ? tests.find(argv[1]) : tests.end();
+	if (test == tests.end())
+	{
+		std::cerr << "resolver_test <test> <scenario directory>, tests :";
+		for (const auto& known : tests)
+			std::cerr << ' ' << known.first;
+		std::cerr << std::endl;
+		return 1;
+	}
+	return test->second(argv[2]);
+}
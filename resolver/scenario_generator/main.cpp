@@ -0,0 +1,87 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "afilesystem.hpp"
+#include "resolver_config.hpp"
+#include "scenario_generator.hpp"
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/parsers.hpp>
+
+static bool parse_terrain_mix(const std::string& str, std::array<float, 3>& mix)
+{
+	std::istringstream stream(str);
+	char separator = 0;
+	stream >> mix[0] >> separator >> mix[1] >> separator >> mix[2];
+	return !stream.fail() && (mix[0] + mix[1] + mix[2]) > 0.f;
+}
+
+int main(int argc, char ** argv)
+{
+	std::cout << "This is scenario generator version " << RESOLVER_VERSION_MAJOR << "." << RESOLVER_VERSION_MINOR << std::endl;
+
+	scenario_parameters params;
+	std::string terrain_mix;
+
+	boost::program_options::options_description desc("Allowed options");
+	desc.add_options()("help", "produce this help message")
+		("o", boost::program_options::value<astd::filesystem::path>(), "<PATH> output directory, a valid resolver input directory")
+		("diameter", boost::program_options::value<std::int32_t>(&params.diameter)->default_value(params.diameter), "<NUM> map diameter")
+		("terrain-mix", boost::program_options::value<std::string>(&terrain_mix)->default_value("60,25,15"), "<PLAIN,HILL,WATER> terrain weights")
+		("players", boost::program_options::value<std::uint32_t>(&params.players)->default_value(params.players), "<NUM> amount of players")
+		("teams", boost::program_options::value<std::uint32_t>(&params.teams)->default_value(params.teams), "<NUM> amount of teams, players are spread between them")
+		("units-per-player", boost::program_options::value<std::uint32_t>(&params.units_per_player)->default_value(params.units_per_player), "<NUM> units owned by each player")
+		("stack-density", boost::program_options::value<float>(&params.stack_density)->default_value(params.stack_density), "<NUM> average units of a player per occupied tile")
+		("orders-per-unit", boost::program_options::value<std::uint32_t>(&params.orders_per_unit)->default_value(params.orders_per_unit), "<NUM> orders given to each unit")
+		("fire-ratio", boost::program_options::value<float>(&params.fire_ratio)->default_value(params.fire_ratio), "<NUM> part of the orders that are FIRE, the others are MOVE")
+		("seed", boost::program_options::value<std::uint32_t>(&params.seed)->default_value(params.seed), "<NUM> random seed")
+		("turn", boost::program_options::value<std::int32_t>(&params.turn)->default_value(params.turn), "<NUM> turn of the order files");
+
+	boost::program_options::variables_map vm;
+	try {
+		boost::program_options::store(boost::program_options::command_line_parser(argc, argv)
+			.options(desc)
+			.style(boost::program_options::command_line_style::unix_style |
+				boost::program_options::command_line_style::allow_long_disguise)
+			.run()
+			, vm);
+
+		boost::program_options::notify(vm);
+	}
+	catch (const boost::program_options::error& e)
+	{
+		std::cerr << "ERROR : " << e.what() << std::endl;
+		std::cout << desc << std::endl;
+		return 1;
+	}
+
+	if (vm.find("help") != vm.end())
+	{
+		std::cout << "scenario_generator [--help] -o <output_path> [options]" << std::endl;
+		std::cout << desc << std::endl;
+		return 0;
+	}
+
+	auto it_output = vm.find("o");
+	if (it_output == vm.end())
+	{
+		std::cerr << "ERROR : No output directory !" << std::endl;
+		std::cout << desc << std::endl;
+		return 1;
+	}
+
+	if (!parse_terrain_mix(terrain_mix, params.terrain_mix))
+	{
+		std::cerr << "ERROR : terrain mix " << terrain_mix << " not valid" << std::endl;
+		return 1;
+	}
+
+	if (params.diameter < 0 || !params.players)
+	{
+		std::cerr << "ERROR : scenario needs a positive diameter and at least one player" << std::endl;
+		return 1;
+	}
+
+	return write_scenario(generate_scenario(params), it_output->second.as<astd::filesystem::path>());
+}
@@ -0,0 +1,307 @@
+#include "scenario_generator.hpp"
+#include "data_dumper.hpp"
+#include "json_writer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace
+{
+   const std::array<coordinate, 6> directions =
+   { {
+      { 1, -1, 0 },{ 1, 0, -1 },{ 0, 1, -1 },{ -1, 1, 0 },{ -1, 0, 1 },{ 0, -1, 1 }
+   } };
+
+   coordinate add(const coordinate& lval, const coordinate& rval, std::int32_t factor = 1)
+   {
+      return{ lval.x + rval.x * factor, lval.y + rval.y * factor, lval.z() + rval.z() * factor };
+   }
+
+   bool on_map(const coordinate& coord, std::int32_t diameter)
+   {
+      return std::max({ std::abs(coord.x), std::abs(coord.y), std::abs(coord.z()) }) <= diameter;
+   }
+
+   unit_action make_action(game_data& data, std::uint32_t num, reference::T_type type, const char* name, std::int32_t soft, std::int32_t hard, std::uint32_t range_min, std::uint32_t range_max, std::int32_t cost)
+   {
+      unit_action result;
+      result.id = reference(type, num);
+      result.name = data.strings->intern(name);
+      result.soft = soft;
+      result.hard = hard;
+      result.range = range_between(range_min, range_max);
+      result.cost = cost;
+      return result;
+   }
+
+   terrain make_terrain(game_data& data, std::uint32_t num, const char* name, float infrastructure, std::int32_t cover, const char* texture)
+   {
+      terrain result;
+      result.id = reference(reference::DTI, num);
+      result.name = data.strings->intern(name);
+      result.infrastructure = infrastructure;
+      result.cover = cover;
+      result.texture_path = data.strings->intern(texture);
+      return result;
+   }
+
+   unit_definition make_unit_def(game_data& data, std::uint32_t num, const char* name, std::initializer_list<std::uint32_t> attacks, std::uint32_t defense, bool can_fire, float cover_usage, const char* texture)
+   {
+      unit_definition result;
+      result.id = reference(reference::DUN, num);
+      result.name = data.strings->intern(name);
+      for (auto att : attacks)
+      {
+         result.attack.emplace_back(reference::ATT, att);
+      }
+      result.defense.emplace_back(reference::DEF, defense);
+      result.order_accessible.emplace_back(order::MOVE);
+      if (can_fire)
+      {
+         result.order_accessible.emplace_back(order::FIRE);
+      }
+      result.action_point = 5;
+      result.cover_usage = cover_usage;
+      result.texture = data.strings->intern(texture);
+      return result;
+   }
+
+   void add_definitions(game_data& data)
+   {
+      data.attack_action.emplace_back(make_action(data, 1, reference::ATT, "Gun", 60, 0, 0, 0, 0));
+      data.attack_action.emplace_back(make_action(data, 2, reference::ATT, "Rocket", 10, 80, 0, 0, -1));
+      data.attack_action.emplace_back(make_action(data, 3, reference::ATT, "Mortar", 0, 40, 1, 2, -1));
+      data.attack_action.emplace_back(make_action(data, 4, reference::ATT, "Cannon", 10, 50, 0, 1, 1));
+      data.attack_action.emplace_back(make_action(data, 5, reference::ATT, "Howitzer", 50, 10, 1, 4, 2));
+
+      data.defense_action.emplace_back(make_action(data, 1, reference::DEF, "Infantry", 2, 10, 0, 0, 0));
+      data.defense_action.emplace_back(make_action(data, 2, reference::DEF, "Tank Armor plate", 40, 30, 0, 0, 0));
+      data.defense_action.emplace_back(make_action(data, 3, reference::DEF, "Artillery Armor plate", 10, 20, 0, 0, 0));
+
+      data.terrains.emplace_back(make_terrain(data, 1, "plain", 3.f, 1, "plain.png"));
+      data.terrains.emplace_back(make_terrain(data, 2, "hill", 2.f, 1, "hill.png"));
+      data.terrains.emplace_back(make_terrain(data, 3, "Water", 0.5f, 1, "water.png"));
+
+      data.unit_defs.emplace_back(make_unit_def(data, 1, "Infantry", { 1 }, 1, false, 2.f, "infantry.png"));
+      data.unit_defs.emplace_back(make_unit_def(data, 2, "Mortar", { 1, 3 }, 1, true, 1.5f, "infantry_mortar.png"));
+      data.unit_defs.emplace_back(make_unit_def(data, 3, "Tank", { 1, 4 }, 2, true, 1.f, "tank.png"));
+      data.unit_defs.emplace_back(make_unit_def(data, 4, "Howitzer", { 5 }, 3, true, 1.f, "howitzer.png"));
+   }
+
+   //tiles exactly at dist from center and inside the map
+   template<typename F>
+   void for_each_ring_tile(const coordinate& center, std::int32_t dist, std::int32_t diameter, F&& func)
+   {
+      if (dist == 0)
+      {
+         func(center);
+         return;
+      }
+
+      auto current = add(center, directions[4], dist);
+      for (const auto& dir : directions)
+      {
+         for (std::int32_t i = 0; i < dist; ++i)
+         {
+            if (on_map(current, diameter))
+               func(current);
+            current = add(current, dir);
+         }
+      }
+   }
+
+   template<typename R>
+   bool random_ring_tile(R& rng, const coordinate& center, std::int32_t dist, std::int32_t diameter, coordinate& result)
+   {
+      std::size_t count = 0;
+      //reservoir sampling, keeps the generation free of allocation per order
+      for_each_ring_tile(center, dist, diameter, [&](const coordinate& tile)
+      {
+         ++count;
+         if (std::uniform_int_distribution<std::size_t>(0, count - 1)(rng) == 0)
+            result = tile;
+      });
+      return count != 0;
+   }
+
+   int write_orders(const game_data& data, const player& owner, const astd::filesystem::path& path)
+   {
+      std::ofstream stream(path.c_str(), std::ios::trunc | std::ios::binary);
+      if (!stream)
+      {
+         return data_dumper::OPEN_FILE;
+      }
+
+      json_writer writer(stream);
+      writer.begin_object();
+      for (const auto& current : data.units)
+      {
+         if (current.owner != owner.id || current.actions.empty())
+            continue;
+
+         writer.key(current.id).begin_array();
+         for (const auto& ord : current.actions)
+         {
+            writer.begin_object();
+            writer.key("action").value(order::serialize(ord.type));
+            if (ord.type == order::FIRE)
+            {
+               writer.key("modifier").value(ord.modifier);
+            }
+            writer.key("x").value(ord.target.x);
+            writer.key("y").value(ord.target.y);
+            writer.end_object();
+         }
+         writer.end_array();
+      }
+      writer.end_object();
+      return writer.flush() ? data_dumper::NONE : data_dumper::OPEN_FILE;
+   }
+}
+
+game_data generate_scenario(const scenario_parameters& params)
+{
+   game_data result;
+   std::mt19937 rng(params.seed);
+   add_definitions(result);
+   result.turn = params.turn;
+
+   auto& current_map = result.current_map;
+   current_map.name = result.strings->intern("Generated map");
+   current_map.description = result.strings->intern("Synthetic scenario");
+   current_map.diameter = params.diameter;
+   current_map.grid.reserve(3 * params.diameter * (params.diameter + 1) + 1);
+
+   std::discrete_distribution<std::uint32_t> terrain_distribution(params.terrain_mix.begin(), params.terrain_mix.end());
+   for (std::int32_t x = -params.diameter; x <= params.diameter; ++x)
+   {
+      for (std::int32_t y = std::max(-params.diameter, -x - params.diameter); y <= std::min(params.diameter, -x + params.diameter); ++y)
+      {
+         current_map.grid.emplace_back(coordinate{ x, y, -x - y }, reference(reference::DTI, terrain_distribution(rng) + 1));
+      }
+   }
+
+   std::uniform_int_distribution<std::size_t> tile_distribution(0, current_map.grid.size() - 1);
+   auto random_tile = [&]() { return current_map.grid[tile_distribution(rng)].first; };
+
+   auto teams = std::max(1u, params.teams);
+   for (std::uint32_t i = 0; i < params.players; ++i)
+   {
+      player new_player;
+      new_player.id = reference(reference::PLY, i + 1);
+      new_player.name = result.strings->intern("Player " + std::to_string(i + 1));
+      new_player.team = static_cast<char>('A' + i % teams);
+      new_player.rally_point.emplace_back(random_tile());
+      result.players.emplace_back(new_player);
+   }
+
+   std::uniform_int_distribution<std::size_t> unit_def_distribution(0, result.unit_defs.size() - 1);
+   std::uniform_int_distribution<std::int32_t> endurance_distribution(50, unit::ENDURANCE_MAX);
+   std::bernoulli_distribution fire_distribution(std::min(std::max(params.fire_ratio, 0.f), 1.f));
+   auto tiles_per_player = static_cast<std::size_t>(std::ceil(params.units_per_player / std::max(params.stack_density, 1.f)));
+   std::vector<coordinate> player_tiles;
+
+   result.units.reserve(std::size_t(params.players) * params.units_per_player);
+   for (const auto& owner : result.players)
+   {
+      player_tiles.clear();
+      for (std::size_t i = 0; i < std::max<std::size_t>(tiles_per_player, 1); ++i)
+      {
+         player_tiles.push_back(random_tile());
+      }
+
+      for (std::uint32_t i = 0; i < params.units_per_player; ++i)
+      {
+         unit new_unit;
+         new_unit.id = reference(reference::UNI, std::uint32_t(result.units.size() + 1));
+         new_unit.owner = owner.id;
+         const auto& def = result.unit_defs[unit_def_distribution(rng)];
+         new_unit.type = def.id;
+         new_unit.pos = player_tiles[i % player_tiles.size()];
+         new_unit.endurance = endurance_distribution(rng);
+
+         auto pos = new_unit.pos;
+         for (std::uint32_t j = 0; j < params.orders_per_unit; ++j)
+         {
+            order ord;
+            bool can_fire = std::find(def.order_accessible.begin(), def.order_accessible.end(), order::FIRE) != def.order_accessible.end();
+            if (can_fire && fire_distribution(rng))
+            {
+               std::uniform_int_distribution<std::size_t> attack_distribution(0, def.attack.size() - 1);
+               ord.type = order::FIRE;
+               ord.modifier = def.attack[attack_distribution(rng)];
+               const auto& att = result.attack_action[ord.modifier.num() - 1];
+               //pick one of the distances of the range, then a tile at that distance
+               std::uniform_int_distribution<std::uint32_t> range_distribution(0, range_count(att.range) - 1);
+               auto picked = range_distribution(rng);
+               std::uint32_t dist = 0;
+               range_for_each(att.range, [&picked, &dist](std::uint32_t distance)
+               {
+                  if (picked-- == 0)
+                     dist = distance;
+               });
+               if (random_ring_tile(rng, pos, static_cast<std::int32_t>(dist), params.diameter, ord.target))
+               {
+                  new_unit.actions.push_back(ord);
+                  continue;
+               }
+            }
+
+            ord.type = order::MOVE;
+            ord.modifier = reference();
+            if (random_ring_tile(rng, pos, 1, params.diameter, ord.target))
+            {
+               pos = ord.target;
+               new_unit.actions.push_back(ord);
+            }
+         }
+         result.units.emplace_back(std::move(new_unit));
+      }
+   }
+
+   return result;
+}
+
+bool parse_scenario_sizes(const std::string& str, scenario_parameters base, std::vector<scenario_parameters>& result)
+{
+   std::istringstream stream(str);
+   std::string size;
+   while (std::getline(stream, size, ','))
+   {
+      std::istringstream size_stream(size);
+      char separator = 0;
+      size_stream >> base.diameter >> separator >> base.units_per_player;
+      if (size_stream.fail() || separator != ':' || base.diameter < 0)
+      {
+         return false;
+      }
+      result.push_back(base);
+   }
+   return !result.empty();
+}
+
+int write_scenario(game_data data, const astd::filesystem::path& directory)
+{
+   if (!astd::filesystem::exists(directory))
+   {
+      astd::filesystem::create_directories(directory);
+   }
+
+   int result = data_dumper::NONE;
+   for (const auto& owner : data.players)
+   {
+      auto filename = "order_" + std::string(owner.id.serialize().data()) + "_" + std::to_string(data.turn) + ".json";
+      result |= write_orders(data, owner, directory / filename);
+   }
+
+   for (auto& current : data.units)
+   {
+      current.actions.clear();
+   }
+
+   data_dumper dump(data, directory);
+   return result | dump.status();
+}
@@ -0,0 +1,35 @@
+#ifndef SCENARIO_GENERATOR_HPP
+#define SCENARIO_GENERATOR_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "afilesystem.hpp"
+#include "data.hpp"
+
+// parameters of a synthetic Proxima game, the same seed always gives the same scenario
+struct scenario_parameters
+{
+   std::int32_t diameter = 10;
+   std::array<float, 3> terrain_mix = { { 60.f, 25.f, 15.f } }; //weights of plain, hill, water
+   std::uint32_t players = 2;
+   std::uint32_t teams = 2;
+   std::uint32_t units_per_player = 100;
+   float stack_density = 1.f; //average amount of units of a player per occupied tile
+   std::uint32_t orders_per_unit = 2;
+   float fire_ratio = 0.3f; //part of the orders that are FIRE, the others are MOVE
+   std::uint32_t seed = 42;
+   std::int32_t turn = 0;
+};
+
+//definitions are the ones of data/proxima, orders are stored in unit::actions
+game_data generate_scenario(const scenario_parameters& params);
+
+//sizes are written <diameter>:<units_per_player>, separated by commas, other parameters come from base
+bool parse_scenario_sizes(const std::string& str, scenario_parameters base, std::vector<scenario_parameters>& result);
+
+//write the input files of the resolver in directory, one order file per player
+int write_scenario(game_data data, const astd::filesystem::path& directory);
+
+#endif //!SCENARIO_GENERATOR_HPP